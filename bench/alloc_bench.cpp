@@ -0,0 +1,247 @@
+#include "benchmarks.hpp"
+#include "devices/ikkegol_pedal.hpp"
+#include "devices/ikkegol_simulator.hpp"
+#include "devices/ikkegol_protocol.hpp"
+#include "configuration/keys.hpp"
+#include "utils/command_line.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+const int DefaultCalls = 100000;
+// Loads go through the transfer layer so are much slower than decoding alone
+const int CallsPerLoad = 1000;
+
+// Every allocation made by the benchmark tool is counted
+std::atomic<uint64_t> allocationCount { 0 };
+
+void *operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    auto *memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+struct AllocationSample {
+    uint64_t allocations;
+    std::chrono::nanoseconds elapsed;
+};
+
+/**
+ * Runs an operation a number of times, counting the allocations it makes.
+ */
+template<typename Operation>
+AllocationSample measureAllocations(int calls, Operation &&operation) {
+    auto allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto call = 0; call < calls; ++call) {
+        operation();
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return { allocationCount.load(std::memory_order_relaxed) - allocationsBefore, elapsed };
+}
+
+/**
+ * One configuration of every kind the protocol supports.
+ */
+std::vector<Configuration> makeSampleConfigurations() {
+    std::vector<Configuration> configs;
+
+    KeyboardConfiguration keyboard;
+    keyboard.addKey(KeyCode::LeftControl);
+    keyboard.addKey(static_cast<uint8_t>(keyCodeFromName("a")));
+    configs.push_back({ Trigger::OnPress, keyboard });
+
+    keyboard.mode = KeyMode::OneShot;
+    keyboard.addKey(static_cast<uint8_t>(keyCodeFromName("f5")));
+    configs.push_back({ Trigger::OnRelease, keyboard });
+
+    MouseConfiguration mouse;
+    mouse.buttons = { MouseButton::Left, MouseButton::Back };
+    configs.push_back({ Trigger::OnPress, mouse });
+
+    mouse = {};
+    mouse.mode = MouseMode::Axis;
+    mouse.relativeX = -5;
+    mouse.relativeY = 10;
+    mouse.wheelDelta = 1;
+    configs.push_back({ Trigger::OnPress, mouse });
+
+    TextConfiguration text;
+    text.setText("Hello, World! 123");
+    configs.push_back({ Trigger::OnPress, text });
+
+    configs.push_back({ Trigger::OnPress, MediaConfiguration { MultiMediaButton::Mute } });
+    configs.push_back({ Trigger::OnPress, GamepadConfiguration { GamepadButton::Button3 } });
+
+    return configs;
+}
+
+void printAllocationHelp(const std::string_view &name) {
+    std::cerr
+        << "Usage: " << name << " allocations [OPTIONS] [help]" << std::endl
+        << std::endl
+        << "  Counts the heap allocations made while decoding and encoding pedal configurations, and while loading a"
+        << std::endl
+        << "  simulated device. Fails if decoding, encoding or loading allocates at all, or if a configuration does"
+        << std::endl
+        << "  not encode back to the bytes it was decoded from." << std::endl
+        << std::endl
+        << "OPTIONS" << std::endl
+        << "  -n, --calls N\t\tThe number of times to decode and encode each configuration. Defaults to "
+        << DefaultCalls << std::endl
+        << "  -m, --model MODEL\tThe model to simulate. Defaults to FS2020U1IR" << std::endl
+        << std::endl;
+}
+
+void printAllocationRow(const char *operation, int calls, const AllocationSample &sample) {
+    std::cout
+        << std::left << std::setw(10) << operation
+        << std::right << std::setw(10) << calls
+        << std::setw(14) << sample.allocations
+        << std::setw(14) << std::fixed << std::setprecision(2)
+        << static_cast<double>(sample.allocations) / calls
+        << std::setw(12) << std::setprecision(1)
+        << static_cast<double>(sample.elapsed.count()) / calls
+        << std::endl;
+}
+
+int allocationBenchmark(const std::string_view &name, const std::vector<std::string_view> &args) {
+    int calls = DefaultCalls;
+    std::string model = "FS2020U1IR";
+
+    for (size_t index = 0; index < args.size(); ++index) {
+        auto &arg = args[index];
+        if (arg == "help") {
+            printAllocationHelp(name);
+            return 0;
+        }
+
+        if (arg != "-n" && arg != "--calls" && arg != "-m" && arg != "--model") {
+            std::cerr << "Unknown option " << arg << std::endl;
+            printAllocationHelp(name);
+            return 1;
+        }
+        if (index + 1 >= args.size()) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+
+        auto &value = args[++index];
+        if (arg == "-m" || arg == "--model") {
+            model = value;
+            continue;
+        }
+
+        auto parsed = parseInt(value);
+        if (!parsed || *parsed <= 0) {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return 1;
+        }
+        calls = *parsed;
+    }
+
+    auto capabilities = getModelCapabilities(model);
+    if (!capabilities) {
+        std::cerr << "Unsupported model " << model << std::endl;
+        return 1;
+    }
+
+    auto configs = makeSampleConfigurations();
+    std::vector<ConfigPacket> packets;
+    for (auto &config: configs) {
+        packets.push_back(encodeConfigPacket(config));
+    }
+
+    for (size_t index = 0; index < packets.size(); ++index) {
+        auto decoded = parseConfig(packets[index]);
+        if (!decoded || !samePacket(encodeConfigPacket(*decoded), packets[index])) {
+            std::cerr << "Sample configuration " << (index + 1) << " does not survive decoding and encoding"
+                << std::endl;
+            return 1;
+        }
+    }
+
+    // Keeps the results alive so the work is not optimised away
+    volatile uint8_t sink = 0;
+
+    auto decode = measureAllocations(calls, [&]() {
+        for (auto &packet: packets) {
+            auto config = parseConfig(packet);
+            sink = sink + static_cast<uint8_t>(config->type());
+        }
+    });
+
+    auto encode = measureAllocations(calls, [&]() {
+        for (auto &config: configs) {
+            auto packet = encodeConfigPacket(config);
+            sink = sink + packet[0];
+        }
+    });
+
+    // Fill every pedal before measuring loads of it
+    auto transport = std::make_unique<IkkegolSimulator>(
+        makeDefaultSimulatorProfile(model, std::chrono::microseconds(0)), "bench"
+    );
+    IkkegolPedal pedal(std::move(transport), 1);
+    if (!pedal.load()) {
+        std::cerr << "Unable to load the simulated device. " << pedal.getLastError() << std::endl;
+        return 1;
+    }
+    for (uint32_t index = 0; index < capabilities->pedals; ++index) {
+        pedal.setConfiguration(index, configs[index % configs.size()]);
+    }
+    if (!pedal.save()) {
+        std::cerr << "Unable to save the simulated device. " << pedal.getLastError() << std::endl;
+        return 1;
+    }
+
+    auto loads = std::max(1, calls / CallsPerLoad);
+    bool loaded = true;
+    auto load = measureAllocations(loads, [&]() {
+        loaded = pedal.load() && loaded;
+    });
+    if (!loaded) {
+        std::cerr << "Unable to load the simulated device. " << pedal.getLastError() << std::endl;
+        return 1;
+    }
+
+    auto configCount = static_cast<int>(configs.size());
+    std::cout << "Simulating " << model << ", " << configCount << " sample configurations" << std::endl;
+    std::cout << std::endl;
+    std::cout
+        << std::left << std::setw(10) << "Operation"
+        << std::right << std::setw(10) << "Calls" << std::setw(14) << "Allocations" << std::setw(14) << "Per call"
+        << std::setw(12) << "ns/call" << std::endl;
+    printAllocationRow("decode", calls * configCount, decode);
+    printAllocationRow("encode", calls * configCount, encode);
+    printAllocationRow("load", loads, load);
+
+    if (decode.allocations > 0 || encode.allocations > 0) {
+        std::cerr << "Decoding and encoding should not allocate" << std::endl;
+        return 1;
+    }
+    // The device was loaded once above, so the transfer queues have already grown as far as they need to
+    if (load.allocations > 0) {
+        std::cerr << "Loading a device should not allocate" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+int faultBenchmark(const std::string_view &name, const std::vector<std::string_view> &args);
+
+int allocationBenchmark(const std::string_view &name, const std::vector<std::string_view> &args);
+
+int keyBenchmark(const std::string_view &name, const std::vector<std::string_view> &args);
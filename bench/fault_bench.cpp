@@ -0,0 +1,329 @@
+#include "benchmarks.hpp"
+#include "devices/ikkegol_pedal.hpp"
+#include "devices/ikkegol_simulator.hpp"
+#include "devices/ikkegol_protocol.hpp"
+#include "utils/command_line.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+const int DefaultIterations = 100;
+const std::chrono::microseconds DefaultLatency(1000);
+
+enum class Operation {
+    Probe,
+    Load,
+    Save,
+    // Save with the writes read back
+    VerifiedSave,
+};
+
+enum class Outcome {
+    Ok,
+    // The operation reported a failure
+    Failed,
+    // The operation reported success, but what it read or wrote is wrong
+    Corrupt,
+};
+
+struct FaultProfile {
+    const char *name;
+    SimulatorFaults faults;
+};
+
+struct Sample {
+    Outcome outcome;
+    std::chrono::microseconds elapsed;
+    uint32_t retries;
+};
+
+std::vector<FaultProfile> makeFaultProfiles() {
+    std::vector<FaultProfile> profiles;
+
+    profiles.push_back({ "healthy", {}});
+
+    SimulatorFaults faults;
+    faults.droppedPage = 0.02;
+    profiles.push_back({ "dropped-pages", faults });
+
+    faults = {};
+    faults.stall = 0.01;
+    profiles.push_back({ "stalls", faults });
+
+    faults = {};
+    faults.shortRead = 0.02;
+    profiles.push_back({ "short-reads", faults });
+
+    faults = {};
+    faults.zeroLengthRead = 0.02;
+    profiles.push_back({ "zero-length", faults });
+
+    faults = {};
+    faults.delayedResponse = 0.05;
+    faults.delayDuration = std::chrono::milliseconds(50);
+    profiles.push_back({ "delayed", faults });
+
+    faults = {};
+    faults.delayedResponse = 0.02;
+    faults.delayDuration = std::chrono::milliseconds(250);
+    profiles.push_back({ "late", faults });
+
+    faults = {};
+    faults.droppedPage = 0.005;
+    faults.stall = 0.005;
+    faults.shortRead = 0.005;
+    faults.zeroLengthRead = 0.005;
+    faults.delayedResponse = 0.01;
+    faults.delayDuration = std::chrono::milliseconds(50);
+    profiles.push_back({ "mixed", faults });
+
+    return profiles;
+}
+
+/**
+ * Checks that the configuration held by the handle is what the simulated firmware actually has.
+ */
+bool matchesSimulator(IkkegolPedal &pedal, const IkkegolSimulator &simulator, const Capabilities &capabilities) {
+    auto &triggerModes = simulator.getTriggerModes();
+
+    for (uint32_t index = 0; index < capabilities.pedals; ++index) {
+        auto slot = index + capabilities.firstPedalIndex;
+        auto &raw = simulator.getSlot(slot);
+        auto &config = pedal.getConfiguration(index);
+
+        if (!config) {
+            if (raw[1] != CT_UNCONFIGURED) {
+                return false;
+            }
+            continue;
+        }
+
+        if (!samePacket(encodeConfigPacket(*config), raw)) {
+            return false;
+        }
+
+        auto trigger = (triggerModes[1 + slot] == TM_RELEASE) ? Trigger::OnRelease : Trigger::OnPress;
+        if (config->trigger != trigger) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Sample runOperation(Operation operation, const SimulatorProfile &profile) {
+    auto transport = std::make_unique<IkkegolSimulator>(profile, "bench");
+    auto *simulator = transport.get();
+    IkkegolPedal pedal(std::move(transport), 1);
+
+    Capabilities capabilities;
+    auto caps = getModelCapabilities(profile.model);
+    if (caps) {
+        capabilities = *caps;
+    }
+
+    // Everything leading up to the measured operation is fault free
+    if (operation != Operation::Probe) {
+        simulator->setFaultsEnabled(false);
+        pedal.probe();
+        if (operation == Operation::Save || operation == Operation::VerifiedSave) {
+            pedal.load();
+            for (uint32_t index = 0; index < capabilities.pedals; ++index) {
+                TextConfiguration text;
+                text.setText("pedal " + std::to_string(index));
+                auto trigger = (index % 2 == 0) ? Trigger::OnRelease : Trigger::OnPress;
+                pedal.setConfiguration(index, { trigger, text });
+            }
+        }
+        simulator->setFaultsEnabled(true);
+    }
+
+    uint32_t retries = 0;
+    pedal.setRetryReporter([&retries](const RetryDecision &decision) {
+        if (decision.backoff) {
+            ++retries;
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    bool succeeded = false;
+    switch (operation) {
+        case Operation::Probe:
+            pedal.probe();
+            succeeded = !pedal.getModel().empty();
+            break;
+        case Operation::Load:
+            succeeded = pedal.load();
+            break;
+        case Operation::Save:
+            succeeded = pedal.save();
+            break;
+        case Operation::VerifiedSave:
+            pedal.setVerifyWrites(true);
+            succeeded = pedal.save();
+            break;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    if (!succeeded) {
+        return { Outcome::Failed, elapsed, retries };
+    }
+
+    bool correct;
+    if (operation == Operation::Probe) {
+        correct = (pedal.getModel() == profile.model && pedal.getVersion() == "SIM");
+    } else {
+        correct = matchesSimulator(pedal, *simulator, capabilities);
+    }
+
+    return { correct ? Outcome::Ok : Outcome::Corrupt, elapsed, retries };
+}
+
+std::string formatPercentile(std::vector<Sample> &samples, double percentile) {
+    auto index = static_cast<size_t>(percentile * static_cast<double>(samples.size() - 1) + 0.5);
+    std::nth_element(
+        samples.begin(), samples.begin() + static_cast<long>(index), samples.end(),
+        [](const Sample &a, const Sample &b) { return a.elapsed < b.elapsed; }
+    );
+
+    std::ostringstream output;
+    output << std::fixed << std::setprecision(1) << samples[index].elapsed.count() / 1000.0;
+    return output.str();
+}
+
+std::string formatRate(const std::vector<Sample> &samples, Outcome outcome) {
+    auto count = std::count_if(samples.begin(), samples.end(), [outcome](const Sample &sample) {
+        return sample.outcome == outcome;
+    });
+
+    std::ostringstream output;
+    output << std::fixed << std::setprecision(1) << 100.0 * static_cast<double>(count) / samples.size() << "%";
+    return output.str();
+}
+
+std::string formatRetries(const std::vector<Sample> &samples) {
+    uint32_t retries = 0;
+    for (auto &sample: samples) {
+        retries += sample.retries;
+    }
+
+    std::ostringstream output;
+    output << std::fixed << std::setprecision(2) << static_cast<double>(retries) / samples.size();
+    return output.str();
+}
+
+void printFaultHelp(const std::string_view &name) {
+    std::cerr
+        << "Usage: " << name << " faults [OPTIONS] [help]" << std::endl
+        << std::endl
+        << "  Probes, loads and saves simulated devices, with and without verification, under a range of fault"
+        << std::endl
+        << "  profiles. Reports how often each operation succeeds, how long it takes and how many retries it needs."
+        << std::endl
+        << "  Timeouts take as long as they would on a real device." << std::endl
+        << std::endl
+        << "OPTIONS" << std::endl
+        << "  -n, --iterations N\tThe number of times to run each operation per profile. Defaults to "
+        << DefaultIterations << std::endl
+        << "  -m, --model MODEL\tThe model to simulate. Defaults to FS2020U1IR" << std::endl
+        << "  -l, --latency US\tThe time taken by each transfer, in microseconds. Defaults to "
+        << DefaultLatency.count() << std::endl
+        << std::endl;
+}
+
+int faultBenchmark(const std::string_view &name, const std::vector<std::string_view> &args) {
+    int iterations = DefaultIterations;
+    std::string model = "FS2020U1IR";
+    auto latency = DefaultLatency;
+
+    for (size_t index = 0; index < args.size(); ++index) {
+        auto &arg = args[index];
+        if (arg == "help") {
+            printFaultHelp(name);
+            return 0;
+        }
+
+        bool takesValue = (
+            arg == "-n" || arg == "--iterations" || arg == "-m" || arg == "--model" || arg == "-l" || arg == "--latency"
+        );
+        if (!takesValue) {
+            std::cerr << "Unknown option " << arg << std::endl;
+            printFaultHelp(name);
+            return 1;
+        }
+        if (index + 1 >= args.size()) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+
+        auto &value = args[++index];
+        if (arg == "-m" || arg == "--model") {
+            model = value;
+            continue;
+        }
+
+        auto parsed = parseInt(value);
+        if (!parsed || *parsed < 0 || ((arg == "-n" || arg == "--iterations") && *parsed == 0)) {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return 1;
+        }
+        if (arg == "-n" || arg == "--iterations") {
+            iterations = *parsed;
+        } else {
+            latency = std::chrono::microseconds(*parsed);
+        }
+    }
+
+    if (!getModelCapabilities(model)) {
+        std::cerr << "Unsupported model " << model << std::endl;
+        return 1;
+    }
+
+    const std::pair<Operation, const char *> operations[] = {
+        { Operation::Probe,        "probe" },
+        { Operation::Load,         "load" },
+        { Operation::Save,         "save" },
+        { Operation::VerifiedSave, "verify" },
+    };
+
+    std::cout << "Simulating " << model << ", " << iterations << " iterations per operation" << std::endl;
+    std::cout << std::endl;
+    std::cout
+        << std::left << std::setw(16) << "Profile" << std::setw(10) << "Operation"
+        << std::right << std::setw(8) << "OK" << std::setw(8) << "Failed" << std::setw(9) << "Corrupt"
+        << std::setw(10) << "p50 ms" << std::setw(10) << "p90 ms" << std::setw(10) << "p99 ms"
+        << std::setw(10) << "max ms" << std::setw(9) << "Retries" << std::endl;
+
+    for (auto &faultProfile: makeFaultProfiles()) {
+        for (auto &[operation, operationName]: operations) {
+            std::vector<Sample> samples;
+            samples.reserve(iterations);
+
+            for (auto iteration = 0; iteration < iterations; ++iteration) {
+                auto profile = makeDefaultSimulatorProfile(model, latency);
+                profile.faults = faultProfile.faults;
+                profile.faults.realTimeouts = true;
+                // Every profile sees the same sequence of seeds so runs are repeatable
+                profile.faults.seed = static_cast<uint32_t>(iteration + 1);
+
+                samples.push_back(runOperation(operation, profile));
+            }
+
+            std::cout
+                << std::left << std::setw(16) << faultProfile.name << std::setw(10) << operationName
+                << std::right << std::setw(8) << formatRate(samples, Outcome::Ok)
+                << std::setw(8) << formatRate(samples, Outcome::Failed)
+                << std::setw(9) << formatRate(samples, Outcome::Corrupt)
+                << std::setw(10) << formatPercentile(samples, 0.5)
+                << std::setw(10) << formatPercentile(samples, 0.9)
+                << std::setw(10) << formatPercentile(samples, 0.99)
+                << std::setw(10) << formatPercentile(samples, 1.0)
+                << std::setw(9) << formatRetries(samples)
+                << std::endl;
+        }
+    }
+
+    return 0;
+}
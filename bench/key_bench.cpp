@@ -0,0 +1,154 @@
+#include "benchmarks.hpp"
+#include "configuration/keys.hpp"
+#include "utils/command_line.hpp"
+#include "utils/usb_scancodes.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+
+const int DefaultRounds = 10000;
+
+const char *const LinearModifierNames[] = {
+    KeyName::LeftControl,
+    KeyName::LeftShift,
+    KeyName::LeftAlt,
+    KeyName::LeftSuper,
+    KeyName::RightControl,
+    KeyName::RightShift,
+    KeyName::RightAlt,
+    KeyName::RightSuper,
+};
+
+/**
+ * How key names were looked up before the hash index, kept as a baseline.
+ */
+int linearKeyCodeFromName(const std::string_view &name) {
+    for (uint8_t index = 0; index < 8; ++index) {
+        if (name == LinearModifierNames[index]) {
+            return KeyCode::FirstModifier + index;
+        }
+    }
+
+    for (size_t index = 0; index < std::size(ScanCodeNames); ++index) {
+        if (ScanCodeNames[index] != nullptr && name == ScanCodeNames[index]) {
+            return static_cast<int>(index);
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Every key name, plus some that are not keys, in the order they would be looked up.
+ */
+std::vector<std::string_view> makeLookupNames() {
+    std::vector<std::string_view> names;
+    for (int code = 0; code < 256; ++code) {
+        auto name = keyNameFromCode(static_cast<uint8_t>(code));
+        if (name != nullptr) {
+            names.emplace_back(name);
+        }
+    }
+
+    names.emplace_back("f25");
+    names.emplace_back("control");
+    names.emplace_back("");
+
+    return names;
+}
+
+/**
+ * The average time taken by a lookup, in nanoseconds.
+ */
+template<typename Key, typename Lookup>
+double measureLookups(int rounds, const std::vector<Key> &keys, Lookup &&lookup) {
+    // Keeps the results alive so the work is not optimised away
+    volatile int sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto round = 0; round < rounds; ++round) {
+        for (auto &key: keys) {
+            sink = sink + lookup(key);
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+        / (static_cast<double>(rounds) * static_cast<double>(keys.size()));
+}
+
+void printKeyHelp(const std::string_view &name) {
+    std::cerr
+        << "Usage: " << name << " keys [OPTIONS] [help]" << std::endl
+        << std::endl
+        << "  Times looking up every key name, by name and by code, against the linear scan it replaced. Fails if"
+        << std::endl
+        << "  the two disagree on any name." << std::endl
+        << std::endl
+        << "OPTIONS" << std::endl
+        << "  -n, --rounds N\tThe number of times to look up every name. Defaults to " << DefaultRounds << std::endl
+        << std::endl;
+}
+
+int keyBenchmark(const std::string_view &name, const std::vector<std::string_view> &args) {
+    int rounds = DefaultRounds;
+
+    for (size_t index = 0; index < args.size(); ++index) {
+        auto &arg = args[index];
+        if (arg == "help") {
+            printKeyHelp(name);
+            return 0;
+        }
+
+        if (arg != "-n" && arg != "--rounds") {
+            std::cerr << "Unknown option " << arg << std::endl;
+            printKeyHelp(name);
+            return 1;
+        }
+        if (index + 1 >= args.size()) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+
+        auto parsed = parseInt(args[++index]);
+        if (!parsed || *parsed <= 0) {
+            std::cerr << "Invalid value for " << arg << ": " << args[index] << std::endl;
+            return 1;
+        }
+        rounds = *parsed;
+    }
+
+    auto names = makeLookupNames();
+    for (auto &keyName: names) {
+        if (keyCodeFromName(keyName) != linearKeyCodeFromName(keyName)) {
+            std::cerr << "Lookups disagree on \"" << keyName << "\"" << std::endl;
+            return 1;
+        }
+    }
+
+    auto linear = measureLookups(rounds, names, [](std::string_view keyName) {
+        return linearKeyCodeFromName(keyName);
+    });
+    auto hashed = measureLookups(rounds, names, [](std::string_view keyName) {
+        return keyCodeFromName(keyName);
+    });
+
+    std::vector<uint8_t> codes;
+    for (int code = 0; code < 256; ++code) {
+        codes.push_back(static_cast<uint8_t>(code));
+    }
+    auto reverse = measureLookups(rounds, codes, [](uint8_t code) {
+        return keyNameFromCode(code) != nullptr ? 1 : 0;
+    });
+
+    std::cout << names.size() << " names, " << rounds << " rounds" << std::endl;
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(16) << "Lookup" << std::right << std::setw(12) << "ns/lookup" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(16) << "name (linear)" << std::right << std::setw(12) << linear << std::endl;
+    std::cout << std::left << std::setw(16) << "name (hashed)" << std::right << std::setw(12) << hashed << std::endl;
+    std::cout << std::left << std::setw(16) << "code" << std::right << std::setw(12) << reverse << std::endl;
+
+    return 0;
+}
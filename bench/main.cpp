@@ -0,0 +1,62 @@
+#include "benchmarks.hpp"
+#include <iostream>
+#include <libusb.h>
+#include <string>
+#include <vector>
+
+void printHelp(const std::string_view &name) {
+    std::cerr
+        << "Usage: " << name << " BENCHMARK { ARGS | help }" << std::endl
+        << std::endl
+        << "  Benchmarks pedalctl against simulated devices." << std::endl
+        << std::endl
+        << "BENCHMARK" << std::endl
+        << "  faults\t\tProbes, loads and saves devices which misbehave in various ways" << std::endl
+        << "  allocations\tCounts the allocations made decoding, encoding and loading configurations" << std::endl
+        << "  keys			Times key name lookups" << std::endl
+        << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string_view> commandLine(argc - 1);
+    for (auto index = 1; index < argc; ++index) {
+        commandLine[index - 1] = std::string_view(argv[index]);
+    }
+
+    std::string_view name = argv[0];
+    auto lastSlash = name.find_last_of('/');
+    if (lastSlash != std::string_view::npos) {
+        name = name.substr(lastSlash + 1);
+    }
+
+    if (commandLine.empty() || commandLine[0] == "-h" || commandLine[0] == "--help") {
+        printHelp(name);
+        return commandLine.empty() ? 1 : 0;
+    }
+
+    auto result = libusb_init(nullptr);
+    if (result < 0) {
+        std::cerr << "Failed to initialize libusb. Error: " << libusb_error_name(result) << std::endl;
+        return 1;
+    }
+
+    auto &benchmarkName = commandLine[0];
+    std::vector<std::string_view> benchmarkArgs { commandLine.begin() + 1, commandLine.end() };
+
+    int exitCode;
+    if (benchmarkName == "faults") {
+        exitCode = faultBenchmark(name, benchmarkArgs);
+    } else if (benchmarkName == "allocations") {
+        exitCode = allocationBenchmark(name, benchmarkArgs);
+    } else if (benchmarkName == "keys") {
+        exitCode = keyBenchmark(name, benchmarkArgs);
+    } else {
+        std::cerr << "Unknown benchmark " << benchmarkName << std::endl;
+        printHelp(name);
+        exitCode = 1;
+    }
+
+    libusb_exit(nullptr);
+
+    return exitCode;
+}
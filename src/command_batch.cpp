@@ -0,0 +1,302 @@
+#include "commands.hpp"
+#include "command_set.hpp"
+#include "devices/ikkegol_pedal.hpp"
+#include "devices/ikkegol_session.hpp"
+#include "configuration/dumper.hpp"
+#include "utils/command_line.hpp"
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+
+void printBatchHelp(const std::string_view &name) {
+    std::cerr
+        << "Usage: " << name << " batch { [FILE] | help }" << std::endl
+        << std::endl
+        << "  Runs commands from a file, or from standard input if FILE is - or not given. Each device is found,"
+        << std::endl
+        << "  opened and claimed once, and stays claimed until the end. Sets are held until the device is shown,"
+        << std::endl
+        << "  saved or the batch ends, then every pedal set on the device is written at once." << std::endl
+        << std::endl
+        << "  Commands are written as they would be on the command line, one per line. Arguments can be quoted."
+        << std::endl
+        << "  Blank lines and lines starting with # are ignored. The batch stops at the first command which fails,"
+        << std::endl
+        << "  and anything set but not yet saved is not written." << std::endl
+        << std::endl
+        << "COMMANDS" << std::endl
+        << "  set DEVICE PEDAL TYPE ARGS\tSets a pedal, as " << name << " set does" << std::endl
+        << "  show DEVICE [PEDAL]\t\tSaves the device, then shows its configuration or that of one pedal" << std::endl
+        << "  save [DEVICE]\t\t\tWrites what has been set on the device, or on every device" << std::endl
+        << std::endl;
+}
+
+/**
+ * Runs the commands of a batch, holding every device it uses open until it is destroyed.
+ */
+class Batch {
+public:
+    explicit Batch(const std::string_view &name) : name(name) {}
+
+    int run(const std::vector<std::string_view> &args) {
+        auto &command = args[0];
+        std::vector<std::string_view> commandArgs { args.begin() + 1, args.end() };
+
+        if (command == "set") {
+            return set(commandArgs);
+        } else if (command == "show") {
+            return show(commandArgs);
+        } else if (command == "save") {
+            return save(commandArgs);
+        } else {
+            std::cerr << "Unknown batch command " << command << std::endl;
+            return 1;
+        }
+    }
+
+    /**
+     * Saves every device, then releases them.
+     */
+    int finish() {
+        auto saved = saveAll();
+
+        for (auto &[portPath, held]: devices) {
+            held.session.reset();
+            reportInterfaceClaims(*held.device);
+        }
+        devices.clear();
+        addresses.clear();
+
+        return saved ? 0 : 1;
+    }
+private:
+    struct HeldDevice {
+        SharedIkkegolPedal device;
+        std::unique_ptr<IkkegolSession> session;
+        // Pedals set since the last save, bit N for pedal N
+        uint32_t setPedals { 0 };
+        // Pedals whose configuration this handle knows to match the device
+        uint32_t knownPedals { 0 };
+    };
+
+    std::string_view name;
+    // By port path, so one device given by index and by port path is still only opened once
+    std::map<std::string, HeldDevice> devices;
+    std::map<std::string, std::string, std::less<>> addresses;
+
+    HeldDevice *getDevice(const std::string_view &address) {
+        auto known = addresses.find(address);
+        if (known != addresses.end()) {
+            return &devices.at(known->second);
+        }
+
+        auto device = findIkkegolDevice(address);
+        if (!device) {
+            std::cerr << "Unable to find device " << address << std::endl;
+            return nullptr;
+        }
+
+        auto portPath = device->getPortPath();
+        auto existing = devices.find(portPath);
+        if (existing == devices.end()) {
+            reportRetries(*device);
+            applyWriteOptions(*device);
+
+            // Identifying the device and everything the batch does with it only claims the interface once
+            auto session = beginHeldSession(*device);
+            if (!session->isClaimed() || !device->isValid()) {
+                std::cerr << "Unable to load device. " << device->getLastError() << std::endl;
+                return nullptr;
+            }
+
+            existing = devices.emplace(portPath, HeldDevice { device, std::move(session) }).first;
+        }
+
+        addresses.emplace(address, portPath);
+        return &existing->second;
+    }
+
+    int set(const std::vector<std::string_view> &args) {
+        if (args.size() < 3) {
+            std::cerr << "Not enough arguments" << std::endl;
+            return 1;
+        }
+
+        auto held = getDevice(args[0]);
+        if (!held) {
+            return 1;
+        }
+
+        auto pedal = parsePedal(args[1], held->device);
+        if (!pedal) {
+            printInvalidPedal(args[1], held->device);
+            return 1;
+        }
+
+        std::vector<std::string_view> configArgs { args.begin() + 3, args.end() };
+        auto config = parseSetConfiguration(name, args[2], configArgs);
+        if (!config) {
+            return 1;
+        }
+
+        if (!held->device->stagePedal(*pedal, *config)) {
+            std::cerr << "Unable to read trigger modes. " << held->device->getLastError() << std::endl;
+            return 1;
+        }
+
+        held->setPedals |= 1u << *pedal;
+        return 0;
+    }
+
+    int show(const std::vector<std::string_view> &args) {
+        if (args.empty()) {
+            std::cerr << "Not enough arguments" << std::endl;
+            return 1;
+        }
+
+        auto held = getDevice(args[0]);
+        if (!held) {
+            return 1;
+        }
+        auto &device = held->device;
+
+        std::optional<int> onlyPedal;
+        if (args.size() > 1) {
+            onlyPedal = parsePedal(args[1], device);
+            if (!onlyPedal) {
+                printInvalidPedal(args[1], device);
+                return 1;
+            }
+        }
+
+        // What is shown is what the device has
+        if (!saveDevice(*held)) {
+            return 1;
+        }
+
+        // Pedals read or written earlier in the batch are not read again
+        auto wanted = onlyPedal ? (1u << *onlyPedal) : IkkegolPedal::AllPedals;
+        auto unknown = wanted & ~held->knownPedals;
+        if (unknown != 0) {
+            if (!device->load(unknown)) {
+                std::cerr << "Unable to read configuration. " << device->getLastError() << std::endl;
+                return 1;
+            }
+            held->knownPedals |= unknown;
+        }
+
+        if (onlyPedal) {
+            std::cout << "Pedal " << (*onlyPedal + 1) << ":" << std::endl;
+            printConfig(device->getConfiguration(*onlyPedal));
+        } else {
+            printDeviceConfiguration(*device);
+        }
+        return 0;
+    }
+
+    int save(const std::vector<std::string_view> &args) {
+        if (args.empty()) {
+            return saveAll() ? 0 : 1;
+        }
+
+        auto held = getDevice(args[0]);
+        if (!held) {
+            return 1;
+        }
+        return saveDevice(*held) ? 0 : 1;
+    }
+
+    bool saveAll() {
+        for (auto &[portPath, held]: devices) {
+            if (!saveDevice(held)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Writes every pedal set on the device since it was last saved.
+     */
+    bool saveDevice(HeldDevice &held) {
+        if (held.setPedals == 0) {
+            return true;
+        }
+
+        auto &device = held.device;
+        if (!device->save()) {
+            std::cerr << "Unable to write configuration. " << device->getLastError() << std::endl;
+            return false;
+        }
+        reportSaveStats(*device);
+
+        auto &stats = device->getLastSaveStats();
+        std::cout << "Device " << device->getPortPath() << ": ";
+        if (stats.pedalsWritten == 0 && !stats.triggerModesWritten) {
+            std::cout << "Configuration unchanged" << std::endl;
+        } else {
+            std::cout << "Updated configuration" << std::endl;
+        }
+
+        for (uint32_t pedal = 0; pedal < device->getPedalCount(); ++pedal) {
+            if ((held.setPedals & (1u << pedal)) != 0) {
+                std::cout << "Pedal " << (pedal + 1) << ":" << std::endl;
+                printConfig(device->getConfiguration(pedal));
+            }
+        }
+
+        held.knownPedals |= held.setPedals;
+        held.setPedals = 0;
+        return true;
+    }
+};
+
+int batchCommand(const std::string_view &name, const std::vector<std::string_view> &args) {
+    if (!args.empty() && args[0] == "help") {
+        printBatchHelp(name);
+        return 0;
+    }
+
+    if (args.size() > 1) {
+        std::cerr << "Too many arguments" << std::endl;
+        printBatchHelp(name);
+        return 1;
+    }
+
+    std::ifstream file;
+    std::istream *input = &std::cin;
+    std::string source = "<stdin>";
+    if (!args.empty() && args[0] != "-") {
+        source = args[0];
+        file.open(source);
+        if (!file) {
+            std::cerr << "Unable to open " << source << std::endl;
+            return 1;
+        }
+        input = &file;
+    }
+
+    Batch batch(name);
+    std::string line;
+    for (int lineNumber = 1; std::getline(*input, line); ++lineNumber) {
+        auto start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+
+        auto arguments = splitArguments(line);
+        if (!arguments) {
+            std::cerr << source << ":" << lineNumber << ": Unterminated quote" << std::endl;
+            return 1;
+        }
+
+        std::vector<std::string_view> commandArgs { arguments->begin(), arguments->end() };
+        if (batch.run(commandArgs) != 0) {
+            std::cerr << source << ":" << lineNumber << ": Stopped at " << (*arguments)[0] << std::endl;
+            return 1;
+        }
+    }
+
+    return batch.finish();
+}
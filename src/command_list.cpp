@@ -1,28 +1,45 @@
 #include "commands.hpp"
 #include "devices/ikkegol_pedal.hpp"
 #include <iostream>
+#include <chrono>
 
 void printListHelp(const std::string_view &name) {
     std::cerr
-        << "Usage: " << name << " list [help]" << std::endl
+        << "Usage: " << name << " list [OPTIONS] [help]" << std::endl
         << std::endl
         << "  List all available pedal devices." << std::endl
+        << std::endl
+        << "OPTIONS" << std::endl
+        << "  -b, --brief\t\tOnly lists device IDs and port paths. Devices are not opened" << std::endl
         << std::endl;
 }
 
 int listCommand(const std::string_view &name, const std::vector<std::string_view> &args) {
-    if (!args.empty()) {
-        if (args[0] == "help") {
+    bool brief = false;
+
+    for (auto &arg: args) {
+        if (arg == "help") {
             printListHelp(name);
             return 0;
+        } else if (arg == "-b" || arg == "--brief") {
+            brief = true;
         } else {
-            std::cerr << "Unknown sub-command " << args[0] << std::endl;
+            std::cerr << "Unknown sub-command " << arg << std::endl;
             printListHelp(name);
             return 1;
         }
     }
 
+    auto start = std::chrono::steady_clock::now();
     auto devices = discoverIkkegolDevices();
+    for (auto &device: devices) {
+        reportRetries(*device);
+    }
+    if (!brief) {
+        probeIkkegolDevices(devices);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
     if (devices.empty()) {
         std::cout << "No devices detected" << std::endl;
         return 0;
@@ -32,14 +49,27 @@ int listCommand(const std::string_view &name, const std::vector<std::string_view
     std::cout << std::endl;
 
     for (auto &device: devices) {
-        std::cout << " " << device->getId() << ": ";
+        std::cout << " " << device->getId() << " (" << device->getPortPath() << ")";
+        if (brief) {
+            std::cout << std::endl;
+            continue;
+        }
 
+        std::cout << ": ";
         if (device->isValid()) {
-            std::cout << device->getModel() << " Version " << device->getVersion() << std::endl;
+            std::cout << device->getModel() << " Version " << device->getVersion();
+            auto latency = device->getHandshakeLatency();
+            if (latency) {
+                std::cout << " (handshake " << latency->count() / 1000.0 << " ms)";
+            }
+            std::cout << std::endl;
         } else {
             std::cout << "* Cannot read device - " << device->getLastError() << std::endl;
         }
     }
 
+    std::cout << std::endl;
+    std::cout << "Discovery took " << elapsed.count() << " ms" << std::endl;
+
     return 0;
 }
@@ -12,7 +12,7 @@ void printSetHelp(const std::string_view &name) {
         << "  Sets the configuration for a device." << std::endl
         << std::endl
         << "ARGUMENTS" << std::endl
-        << "  DEVICE\t\tThe device index to configure" << std::endl
+        << "  DEVICE\t\tThe device index or USB port path (eg. 1-2.3) to configure" << std::endl
         << "  PEDAL\t\t\tThe pedal name or index" << std::endl
         << std::endl
         << "TYPE" << std::endl
@@ -24,8 +24,6 @@ void printSetHelp(const std::string_view &name) {
         << std::endl;
 }
 
-std::optional<int> parsePedal(const std::string_view &rawPedal, const SharedIkkegolPedal &device);
-
 int setCommand(const std::string_view &name, const std::vector<std::string_view> &args) {
     if (!args.empty() && args[0] == "help") {
         printSetHelp(name);
@@ -39,19 +37,17 @@ int setCommand(const std::string_view &name, const std::vector<std::string_view>
     }
 
     // Device
-    auto deviceId = parseInt(args[0]);
-    if (!deviceId || *deviceId < 1) {
-        std::cerr << "Invalid device index " << args[0] << std::endl;
-        return 1;
-    }
-
-    auto device = findIkkegolDevice(*deviceId);
+    auto device = findIkkegolDevice(args[0]);
     if (!device) {
-        std::cerr << "Unable to find device " << *deviceId << std::endl;
+        std::cerr << "Unable to find device " << args[0] << std::endl;
         return 1;
     }
+    reportRetries(*device);
+    applyWriteOptions(*device);
 
-    if (!device->isValid()) {
+    // Identifying the device, reading its configuration and writing it back only claims the interface once
+    auto session = beginCommandSession(*device);
+    if (!session.isClaimed() || !device->isValid()) {
         std::cerr << "Unable to load device. " << device->getLastError() << std::endl;
         return 1;
     }
@@ -59,65 +55,56 @@ int setCommand(const std::string_view &name, const std::vector<std::string_view>
     // Pedal
     auto pedal = parsePedal(args[1], device);
     if (!pedal) {
-        std::cerr << "Invalid pedal name or index '" << args[1] << "'" << std::endl;
-        std::cerr << "Possible values:" << std::endl;
-        std::cerr << " ";
-        for (auto pedalIndex = 0; pedalIndex < device->getPedalCount(); ++pedalIndex) {
-            if (pedalIndex != 0) {
-                std::cerr << ", ";
-            }
-
-            auto pedalName = device->getPedalName(pedalIndex);
-            std::cerr << (pedalIndex + 1);
-            if (!pedalName.empty()) {
-                std::cerr << ", " << pedalName;
-            }
-        }
-        std::cerr << std::endl;
+        printInvalidPedal(args[1], device);
         return 1;
     }
 
-    std::optional<SharedConfiguration> config;
-    auto &commandName = args[2];
     std::vector<std::string_view> commandArgs { args.begin() + 3, args.end() };
-
-    if (commandName == "keyboard") {
-        config = parseSetKeyboardOptions(name, commandArgs);
-    } else if (commandName == "mouse") {
-        config = parseSetMouseOptions(name, commandArgs);
-    } else if (commandName == "text") {
-        config = parseSetTextOptions(name, commandArgs);
-    } else if (commandName == "media") {
-        config = parseSetMediaOptions(name, commandArgs);
-    } else if (commandName == "game") {
-        config = parseSetGameOptions(name, commandArgs);
-    } else {
-        std::cerr << "Unknown configuration type " << commandName << std::endl;
-        printSetHelp(name);
-        return 1;
-    }
-
+    auto config = parseSetConfiguration(name, args[2], commandArgs);
     if (!config) {
         return 1;
     }
 
-    if (!device->load()) {
-        std::cerr << "Failed to load current config. " << device->getLastError() << std::endl;
+    // Only the pedal being set is written. The rest of the device does not need to be loaded for that.
+    if (!device->savePedal(*pedal, *config)) {
+        std::cerr << "Unable to write configuration. " << device->getLastError() << std::endl;
         return 1;
     }
 
-    device->setConfiguration(*pedal, *config);
+    session.end();
+    reportInterfaceClaims(*device);
+    reportSaveStats(*device);
 
-    if (!device->save()) {
-        std::cerr << "Unable to write configuration. " << device->getLastError() << std::endl;
-        return 1;
+    auto &stats = device->getLastSaveStats();
+    if (stats.pedalsWritten == 0 && !stats.triggerModesWritten) {
+        std::cout << "Configuration unchanged" << std::endl;
+    } else {
+        std::cout << "Updated configuration" << std::endl;
     }
-
-    std::cout << "Updated configuration" << std::endl;
     printConfig(*config);
     return 0;
 }
 
+std::optional<Configuration> parseSetConfiguration(
+    const std::string_view &name, const std::string_view &type, const std::vector<std::string_view> &args
+) {
+    if (type == "keyboard") {
+        return parseSetKeyboardOptions(name, args);
+    } else if (type == "mouse") {
+        return parseSetMouseOptions(name, args);
+    } else if (type == "text") {
+        return parseSetTextOptions(name, args);
+    } else if (type == "media") {
+        return parseSetMediaOptions(name, args);
+    } else if (type == "game") {
+        return parseSetGameOptions(name, args);
+    } else {
+        std::cerr << "Unknown configuration type " << type << std::endl;
+        printSetHelp(name);
+        return {};
+    }
+}
+
 std::optional<int> parsePedal(const std::string_view &rawPedal, const SharedIkkegolPedal &device) {
     auto pedalIndex = parseInt(rawPedal);
 
@@ -138,4 +125,22 @@ std::optional<int> parsePedal(const std::string_view &rawPedal, const SharedIkke
         }
         return *pedalIndex - 1;
     }
-}
\ No newline at end of file
+}
+
+void printInvalidPedal(const std::string_view &rawPedal, const SharedIkkegolPedal &device) {
+    std::cerr << "Invalid pedal name or index '" << rawPedal << "'" << std::endl;
+    std::cerr << "Possible values:" << std::endl;
+    std::cerr << " ";
+    for (auto pedalIndex = 0; pedalIndex < device->getPedalCount(); ++pedalIndex) {
+        if (pedalIndex != 0) {
+            std::cerr << ", ";
+        }
+
+        auto pedalName = device->getPedalName(pedalIndex);
+        std::cerr << (pedalIndex + 1);
+        if (!pedalName.empty()) {
+            std::cerr << ", " << pedalName;
+        }
+    }
+    std::cerr << std::endl;
+}
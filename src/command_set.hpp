@@ -1,22 +1,58 @@
 #pragma once
 
-#include "configuration/base.hpp"
+#include "configuration/configuration.hpp"
 #include <vector>
 #include <optional>
+#include <ostream>
 #include <string>
 
-std::optional<SharedConfiguration> parseSetKeyboardOptions(
+/**
+ * Parses the arguments of a set command which follow the pedal, starting with the configuration type.
+ */
+std::optional<Configuration> parseSetConfiguration(
+    const std::string_view &name, const std::string_view &type, const std::vector<std::string_view> &args
+);
+std::optional<Configuration> parseSetKeyboardOptions(
     const std::string_view &name, const std::vector<std::string_view> &args
 );
-std::optional<SharedConfiguration> parseSetMouseOptions(
+std::optional<Configuration> parseSetMouseOptions(
     const std::string_view &name, const std::vector<std::string_view> &args
 );
-std::optional<SharedConfiguration> parseSetTextOptions(
+std::optional<Configuration> parseSetTextOptions(
     const std::string_view &name, const std::vector<std::string_view> &args
 );
-std::optional<SharedConfiguration> parseSetMediaOptions(
+std::optional<Configuration> parseSetMediaOptions(
     const std::string_view &name, const std::vector<std::string_view> &args
 );
-std::optional<SharedConfiguration> parseSetGameOptions(
+std::optional<Configuration> parseSetGameOptions(
     const std::string_view &name, const std::vector<std::string_view> &args
-);
\ No newline at end of file
+);
+/**
+ * Prints the command line names from an EnumTable as a comma separated list, wrapped to fit a terminal.
+ */
+template<typename Table>
+void printNameList(std::ostream &output, const Table &table) {
+    const size_t Indent = 4;
+    const size_t MaxWidth = 80;
+
+    auto width = Indent;
+    output << std::string(Indent, ' ');
+    bool first = true;
+    for (auto &entry: table.all()) {
+        if (!first) {
+            output << ",";
+            ++width;
+            if (width + 1 + entry.name.size() + 1 > MaxWidth) {
+                output << std::endl << std::string(Indent, ' ');
+                width = Indent;
+            } else {
+                output << " ";
+                ++width;
+            }
+        }
+        first = false;
+        output << entry.name;
+        width += entry.name.size();
+    }
+    output << std::endl;
+}
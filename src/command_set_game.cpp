@@ -20,14 +20,13 @@ void printSetGameHelp(const std::string_view &name) {
         << "  -i, --invert\t\tInverts pedal activation. The button will be pressed when" << std::endl
         << "  \t\t\tthe pedal is released." << std::endl
         << "BUTTON" << std::endl
-        << "  Available gamepad keys:" << std::endl
-        << "    left, right, up, down, button1, button2, button3, button4, button5" << std::endl
-        << "    button6, button7, button8" << std::endl
-        << std::endl;
+        << "  Available gamepad keys:" << std::endl;
+    printNameList(std::cerr, GamepadButtonTable);
+    std::cerr << std::endl;
 }
 
 
-std::optional<SharedConfiguration> parseSetGameOptions(
+std::optional<Configuration> parseSetGameOptions(
     const std::string_view &name, const std::vector<std::string_view> &args
 ) {
     if (args.empty()) {
@@ -71,44 +70,23 @@ std::optional<SharedConfiguration> parseSetGameOptions(
         return {};
     }
 
-    auto config = std::make_shared<GamepadConfiguration>();
+    Configuration config;
+    auto &gamepad = config.value.emplace<GamepadConfiguration>();
     auto &button = args[nextArgIndex];
 
     if (invert) {
-        config->trigger = Trigger::OnRelease;
+        config.trigger = Trigger::OnRelease;
     } else {
-        config->trigger = Trigger::OnPress;
+        config.trigger = Trigger::OnPress;
     }
 
-    if (button == "left") {
-        config->button = GamepadButton::Left;
-    } else if (button == "right") {
-        config->button = GamepadButton::Right;
-    } else if (button == "up") {
-        config->button = GamepadButton::Up;
-    } else if (button == "down") {
-        config->button = GamepadButton::Down;
-    } else if (button == "button1") {
-        config->button = GamepadButton::Button1;
-    } else if (button == "button2") {
-        config->button = GamepadButton::Button2;
-    } else if (button == "button3") {
-        config->button = GamepadButton::Button3;
-    } else if (button == "button4") {
-        config->button = GamepadButton::Button4;
-    } else if (button == "button5") {
-        config->button = GamepadButton::Button5;
-    } else if (button == "button6") {
-        config->button = GamepadButton::Button6;
-    } else if (button == "button7") {
-        config->button = GamepadButton::Button7;
-    } else if (button == "button8") {
-        config->button = GamepadButton::Button8;
-    } else {
+    auto gamepadButton = GamepadButtonTable.fromName(button);
+    if (!gamepadButton) {
         std::cerr << "Unknown button " << button << std::endl;
         printSetGameHelp(name);
         return {};
     }
+    gamepad.button = *gamepadButton;
 
     return config;
 }
@@ -54,7 +54,7 @@ void printSetKeyboardHelp(const std::string_view &name) {
 }
 
 
-std::optional<SharedConfiguration> parseSetKeyboardOptions(
+std::optional<Configuration> parseSetKeyboardOptions(
     const std::string_view &name, const std::vector<std::string_view> &args
 ) {
     if (args.empty()) {
@@ -108,23 +108,23 @@ std::optional<SharedConfiguration> parseSetKeyboardOptions(
 
     auto &keys = args[nextArgIndex];
 
-    auto keyboard = std::make_shared<KeyboardConfiguration>();
+    Configuration config;
+    auto &keyboard = config.value.emplace<KeyboardConfiguration>();
     if (once) {
-        keyboard->mode = KeyMode::OneShot;
+        keyboard.mode = KeyMode::OneShot;
     } else {
-        keyboard->mode = KeyMode::Standard;
+        keyboard.mode = KeyMode::Standard;
     }
 
     if (invert) {
-        keyboard->trigger = Trigger::OnRelease;
+        config.trigger = Trigger::OnRelease;
     } else {
-        keyboard->trigger = Trigger::OnPress;
+        config.trigger = Trigger::OnPress;
     }
 
-    keyboard->keys = split(keys, '+');
-
-    int nonModifierCount = 0;
-    for (auto &key: keyboard->keys) {
+    auto keyNames = split(keys, '+');
+    size_t nonModifierCount = 0;
+    for (auto &key: keyNames) {
         if (!isValidKey(key)) {
             std::cerr << "Unknown key " << key << std::endl;
             return {};
@@ -134,10 +134,14 @@ std::optional<SharedConfiguration> parseSetKeyboardOptions(
         }
     }
 
-    if (nonModifierCount > 6) {
+    if (nonModifierCount > KeyboardConfiguration::MaxKeys) {
         std::cerr << "Too many non-modifier keys. Only 6 keys may be given at once" << std::endl;
         return {};
     }
 
-    return keyboard;
+    for (auto &key: keyNames) {
+        keyboard.addKey(static_cast<uint8_t>(keyCodeFromName(key)));
+    }
+
+    return config;
 }
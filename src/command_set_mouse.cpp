@@ -36,7 +36,7 @@ void printSetMouseHelp(const std::string_view &name) {
 }
 
 
-std::optional<SharedConfiguration> parseSetMouseOptions(
+std::optional<Configuration> parseSetMouseOptions(
     const std::string_view &name, const std::vector<std::string_view> &args
 ) {
     if (args.empty()) {
@@ -83,51 +83,42 @@ std::optional<SharedConfiguration> parseSetMouseOptions(
         return {};
     }
 
-    auto config = std::make_shared<MouseConfiguration>();
+    Configuration config;
+    auto &mouse = config.value.emplace<MouseConfiguration>();
 
     if (invert) {
-        config->trigger = Trigger::OnRelease;
+        config.trigger = Trigger::OnRelease;
     } else {
-        config->trigger = Trigger::OnPress;
+        config.trigger = Trigger::OnPress;
     }
 
     auto remainingArgCount = args.size() - nextArgIndex;
     if (remainingArgCount == 1) {
-        config->mode = MouseMode::Buttons;
+        mouse.mode = MouseMode::Buttons;
         auto buttons = split(args[nextArgIndex], '+');
         for (auto &buttonName: buttons) {
-            MouseButton button;
-            if (buttonName == "left") {
-                button = MouseButton::Left;
-            } else if (buttonName == "right") {
-                button = MouseButton::Right;
-            } else if (buttonName == "middle") {
-                button = MouseButton::Middle;
-            } else if (buttonName == "forward") {
-                button = MouseButton::Forward;
-            } else if (buttonName == "back") {
-                button = MouseButton::Back;
-            } else {
+            auto button = parseMouseButton(buttonName);
+            if (!button) {
                 std::cerr << "Unknown button " << buttonName << std::endl;
                 printSetMouseHelp(name);
                 return {};
             }
 
-            if (config->buttons.count(button) > 0) {
+            if (mouse.buttons.contains(*button)) {
                 std::cerr << buttonName << " button already specified" << std::endl;
                 return {};
             }
 
-            config->buttons.insert(button);
+            mouse.buttons.insert(*button);
         }
 
-        if (config->buttons.empty()) {
+        if (mouse.buttons.empty()) {
             std::cerr << "At least one button must be provided. Alternatively, enter mouse movements" << std::endl;
             printSetMouseHelp(name);
             return {};
         }
     } else {
-        config->mode = MouseMode::Axis;
+        mouse.mode = MouseMode::Axis;
 
         if (remainingArgCount < 2) {
             printSetMouseHelp(name);
@@ -146,8 +137,8 @@ std::optional<SharedConfiguration> parseSetMouseOptions(
             return {};
         }
 
-        config->relativeX = static_cast<int8_t>(*xMovement);
-        config->relativeY = static_cast<int8_t>(*yMovement);
+        mouse.relativeX = static_cast<int8_t>(*xMovement);
+        mouse.relativeY = static_cast<int8_t>(*yMovement);
 
         if (remainingArgCount >= 3) {
             auto wheel = parseInt(args[nextArgIndex + 2]);
@@ -157,7 +148,7 @@ std::optional<SharedConfiguration> parseSetMouseOptions(
                 return {};
             }
 
-            config->wheelDelta = static_cast<int8_t>(*wheel);
+            mouse.wheelDelta = static_cast<int8_t>(*wheel);
         }
     }
 
@@ -24,7 +24,7 @@ void printSetTextHelp(const std::string_view &name) {
 }
 
 
-std::optional<SharedConfiguration> parseSetTextOptions(
+std::optional<Configuration> parseSetTextOptions(
     const std::string_view &name, const std::vector<std::string_view> &args
 ) {
     if (args.empty()) {
@@ -83,13 +83,14 @@ std::optional<SharedConfiguration> parseSetTextOptions(
         remaining = remaining.substr(0, 38);
     }
 
-    auto config = std::make_shared<TextConfiguration>();
-    config->text = remaining;
+    TextConfiguration text;
+    text.setText(remaining);
 
+    Configuration config { Trigger::OnPress, text };
     if (invert) {
-        config->trigger = Trigger::OnRelease;
+        config.trigger = Trigger::OnRelease;
     } else {
-        config->trigger = Trigger::OnPress;
+        config.trigger = Trigger::OnPress;
     }
 
     return config;
@@ -1,34 +1,23 @@
 #include "commands.hpp"
 #include "devices/ikkegol_pedal.hpp"
-#include "configuration/keyboard.hpp"
-#include "configuration/text.hpp"
-#include "configuration/mouse.hpp"
-#include "configuration/gamepad.hpp"
-#include "configuration/media.hpp"
 #include "configuration/dumper.hpp"
 #include "utils/command_line.hpp"
 #include <iostream>
 
-void printConfig(SharedConfiguration config);
-void printKeyboardConfig(KeyboardConfiguration &config);
-void printTextConfig(TextConfiguration &config);
-void printMouseConfig(MouseConfiguration &config);
-void printGamepadConfig(GamepadConfiguration &config);
-void printMediaConfig(MediaConfiguration &config);
-
 void printShowHelp(const std::string_view &name) {
     std::cerr
-        << "Usage: " << name << " show { DEVICE | help }" << std::endl
+        << "Usage: " << name << " show { DEVICE [PEDAL] | help }" << std::endl
         << std::endl
-        << "  Shows the current configuration of a device" << std::endl
+        << "  Shows the current configuration of a device, or of one of its pedals" << std::endl
         << std::endl
         << "ARGUMENTS" << std::endl
-        << "  DEVICE\t\tThe index of the device" << std::endl
+        << "  DEVICE\t\tThe index or USB port path (eg. 1-2.3) of the device" << std::endl
+        << "  PEDAL\t\t\tThe pedal name or index. Only this pedal is read from the device" << std::endl
         << std::endl;
 }
 
 int showCommand(const std::string_view &name, const std::vector<std::string_view> &args) {
-    uint32_t deviceId;
+    std::string_view deviceAddress;
 
     if (args.empty()) {
         printShowHelp(name);
@@ -39,41 +28,62 @@ int showCommand(const std::string_view &name, const std::vector<std::string_view
         printShowHelp(name);
         return 0;
     } else {
-        auto id = parseInt(args[0]);
-        if (!id || *id < 1) {
-            std::cerr << "Invalid device index " << args[0] << std::endl;
-            return 1;
-        }
-
-        deviceId = *id;
+        deviceAddress = args[0];
     }
 
-    auto device = findIkkegolDevice(deviceId);
+    auto device = findIkkegolDevice(deviceAddress);
     if (!device) {
-        std::cerr << "Unable to find device " << deviceId << std::endl;
+        std::cerr << "Unable to find device " << deviceAddress << std::endl;
         return 1;
     }
+    reportRetries(*device);
 
-    if (!device->isValid()) {
+    // Identifying the device and reading its configuration only claims the interface once
+    auto session = beginCommandSession(*device);
+    if (!session.isClaimed() || !device->isValid()) {
         std::cerr << "Unable to load device. " << device->getLastError() << std::endl;
         return 1;
     }
 
-    if (!device->load()) {
+    std::optional<int> onlyPedal;
+    if (args.size() > 1) {
+        onlyPedal = parsePedal(args[1], device);
+        if (!onlyPedal) {
+            printInvalidPedal(args[1], device);
+            return 1;
+        }
+    }
+
+    // A single pedal only needs its own configuration, and the trigger modes
+    auto loaded = onlyPedal ? device->loadPedal(*onlyPedal) : device->load();
+    if (!loaded) {
         std::cerr << "Unable to read configuration. " << device->getLastError() << std::endl;
         return 1;
     }
 
+    session.end();
+    reportInterfaceClaims(*device);
+
+    if (onlyPedal) {
+        std::cout << "Pedal " << (*onlyPedal + 1) << ":" << std::endl;
+        printConfig(device->getConfiguration(*onlyPedal));
+        return 0;
+    }
+
+    printDeviceConfiguration(*device);
+    return 0;
+}
+
+void printDeviceConfiguration(IkkegolPedal &device) {
     std::cout << "Device information:" << std::endl;
     std::cout << std::endl;
-    std::cout << "Model: " << device->getModel() << std::endl;
-    std::cout << "Pedals: " << device->getPedalCount() << std::endl;
+    std::cout << "Model: " << device.getModel() << std::endl;
+    std::cout << "Port: " << device.getPortPath() << std::endl;
+    std::cout << "Pedals: " << device.getPedalCount() << std::endl;
 
     std::cout << std::endl;
-    for (auto pedal = 0; pedal < device->getPedalCount(); ++pedal) {
+    for (auto pedal = 0; pedal < device.getPedalCount(); ++pedal) {
         std::cout << "Pedal " << (pedal + 1) << ":" << std::endl;
-        printConfig(device->getConfiguration(pedal));
+        printConfig(device.getConfiguration(pedal));
     }
-
-    return 0;
 }
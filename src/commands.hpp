@@ -1,8 +1,59 @@
 #pragma once
 
+#include "devices/ikkegol_pedal.hpp"
+#include <memory>
 #include <vector>
 #include <string>
+#include <optional>
+
+/**
+ * Prints the decisions of the device's retry policy if --verbose was given.
+ */
+void reportRetries(IkkegolPedal &device);
+
+/**
+ * Applies the options which change how configuration is written, such as --verify.
+ */
+void applyWriteOptions(IkkegolPedal &device);
+
+/**
+ * Starts a session covering everything a command does with the device, following the --no-reattach option.
+ */
+IkkegolSession beginCommandSession(IkkegolPedal &device);
+
+/**
+ * Prints how often the config interface was claimed if --verbose was given.
+ */
+void reportInterfaceClaims(IkkegolPedal &device);
+
+/**
+ * Prints what the last save wrote and skipped if --verbose was given.
+ */
+void reportSaveStats(IkkegolPedal &device);
+
+/**
+ * Parses a pedal given by name or 1-based index.
+ * @returns the index of the pedal
+ */
+std::optional<int> parsePedal(const std::string_view &rawPedal, const SharedIkkegolPedal &device);
+
+/**
+ * Reports a pedal that parsePedal() did not accept, along with the possible values.
+ */
+void printInvalidPedal(const std::string_view &rawPedal, const SharedIkkegolPedal &device);
+
+/**
+ * Prints the model and port of a device along with the configuration this handle holds for each pedal.
+ */
+void printDeviceConfiguration(IkkegolPedal &device);
+
+/**
+ * Starts a session which lasts until it is destroyed, following the --no-reattach option. For commands which keep
+ * several devices claimed at once.
+ */
+std::unique_ptr<IkkegolSession> beginHeldSession(IkkegolPedal &device);
 
 int listCommand(const std::string_view &name, const std::vector<std::string_view> &args);
 int showCommand(const std::string_view &name, const std::vector<std::string_view> &args);
-int setCommand(const std::string_view &name, const std::vector<std::string_view> &args);
\ No newline at end of file
+int setCommand(const std::string_view &name, const std::vector<std::string_view> &args);
+int batchCommand(const std::string_view &name, const std::vector<std::string_view> &args);
\ No newline at end of file
@@ -1,8 +1,8 @@
 #pragma once
 
-#include <memory>
+#include <cstdint>
 
-enum class ConfigurationType {
+enum class ConfigurationType : uint8_t {
     Keyboard,
     Mouse,
     Text,
@@ -10,18 +10,7 @@ enum class ConfigurationType {
     Gamepad,
 };
 
-enum class Trigger {
+enum class Trigger : uint8_t {
     OnPress,
     OnRelease
 };
-
-class BaseConfiguration {
-public:
-    virtual ConfigurationType type() const = 0;
-
-    Trigger trigger { Trigger::OnPress };
-
-private:
-};
-
-typedef std::shared_ptr<BaseConfiguration> SharedConfiguration;
\ No newline at end of file
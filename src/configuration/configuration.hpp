@@ -0,0 +1,40 @@
+#pragma once
+
+#include "base.hpp"
+#include "keyboard.hpp"
+#include "mouse.hpp"
+#include "text.hpp"
+#include "media.hpp"
+#include "gamepad.hpp"
+#include <optional>
+#include <type_traits>
+#include <variant>
+
+/**
+ * The configuration of a single pedal. It is a plain value: copying one never allocates, and it fits in a cache line.
+ * The alternatives are in the same order as ConfigurationType.
+ */
+struct Configuration {
+    typedef std::variant<
+        KeyboardConfiguration, MouseConfiguration, TextConfiguration, MediaConfiguration, GamepadConfiguration
+    > Value;
+
+    Trigger trigger { Trigger::OnPress };
+    Value value;
+
+    ConfigurationType type() const { return static_cast<ConfigurationType>(value.index()); }
+};
+
+/**
+ * A pedal's configuration, or nothing if the pedal is not configured.
+ */
+typedef std::optional<Configuration> PedalConfiguration;
+
+static_assert(std::is_trivially_copyable_v<Configuration>);
+static_assert(sizeof(PedalConfiguration) <= 64);
+static_assert(
+    std::is_same_v<
+        std::variant_alternative_t<static_cast<size_t>(ConfigurationType::Gamepad), Configuration::Value>,
+        GamepadConfiguration
+    >
+);
@@ -1,21 +1,22 @@
 #include "dumper.hpp"
 
-#include "keyboard.hpp"
-#include "text.hpp"
-#include "mouse.hpp"
-#include "gamepad.hpp"
-#include "media.hpp"
 #include "keys.hpp"
 #include <iostream>
 
-void printKeyboardConfig(KeyboardConfiguration &config);
-void printTextConfig(TextConfiguration &config);
-void printMouseConfig(MouseConfiguration &config);
-void printGamepadConfig(GamepadConfiguration &config);
-void printMediaConfig(MediaConfiguration &config);
+// Modifiers are shown pairwise, the way they have always been
+const uint8_t ModifierDisplayOrder[] = {
+    KeyCode::LeftControl, KeyCode::RightControl, KeyCode::LeftShift, KeyCode::RightShift,
+    KeyCode::LeftAlt, KeyCode::RightAlt, KeyCode::LeftSuper, KeyCode::RightSuper,
+};
 
+void printKeyboardConfig(const KeyboardConfiguration &config);
+void printTextConfig(const TextConfiguration &config);
+void printMouseConfig(const MouseConfiguration &config);
+void printGamepadConfig(const GamepadConfiguration &config);
+void printMediaConfig(const MediaConfiguration &config);
 
-void printConfig(SharedConfiguration config) {
+
+void printConfig(const PedalConfiguration &config) {
     if (!config) {
         std::cout << "  No configuration" << std::endl;
         return;
@@ -30,23 +31,23 @@ void printConfig(SharedConfiguration config) {
 
     switch (config->type()) {
         case ConfigurationType::Keyboard: {
-            printKeyboardConfig(static_cast<KeyboardConfiguration &>(*config));
+            printKeyboardConfig(std::get<KeyboardConfiguration>(config->value));
             break;
         }
         case ConfigurationType::Mouse: {
-            printMouseConfig(static_cast<MouseConfiguration &>(*config));
+            printMouseConfig(std::get<MouseConfiguration>(config->value));
             break;
         }
         case ConfigurationType::Text: {
-            printTextConfig(static_cast<TextConfiguration &>(*config));
+            printTextConfig(std::get<TextConfiguration>(config->value));
             break;
         }
         case ConfigurationType::Media: {
-            printMediaConfig(static_cast<MediaConfiguration &>(*config));
+            printMediaConfig(std::get<MediaConfiguration>(config->value));
             break;
         }
         case ConfigurationType::Gamepad: {
-            printGamepadConfig(static_cast<GamepadConfiguration &>(*config));
+            printGamepadConfig(std::get<GamepadConfiguration>(config->value));
             break;
         }
         default: {
@@ -56,7 +57,7 @@ void printConfig(SharedConfiguration config) {
     };
 }
 
-void printKeyboardConfig(KeyboardConfiguration &config) {
+void printKeyboardConfig(const KeyboardConfiguration &config) {
     std::cout << "  Mode: ";
     if (config.mode == KeyMode::Standard) {
         std::cout << "Standard" << std::endl;
@@ -66,7 +67,23 @@ void printKeyboardConfig(KeyboardConfiguration &config) {
 
     std::cout << "  Key: ";
     bool first = true;
-    for (auto &key: config.keys) {
+    for (auto modifier: ModifierDisplayOrder) {
+        if ((config.modifiers & (1 << (modifier - KeyCode::FirstModifier))) == 0) {
+            continue;
+        }
+
+        if (!first) {
+            std::cout << " + ";
+        }
+        first = false;
+        std::cout << keyNameFromCode(modifier);
+    }
+    for (size_t index = 0; index < config.keyCount(); ++index) {
+        auto key = keyNameFromCode(config.keys[index]);
+        if (key == nullptr) {
+            continue;
+        }
+
         if (!first) {
             std::cout << " + ";
         }
@@ -76,147 +93,23 @@ void printKeyboardConfig(KeyboardConfiguration &config) {
     std::cout << std::endl;
 }
 
-void printTextConfig(TextConfiguration &config) {
-    std::cout << " Text: " << config.text << std::endl;
+void printTextConfig(const TextConfiguration &config) {
+    std::cout << " Text: " << config.getText() << std::endl;
 }
 
-void printMouseConfig(MouseConfiguration &config) {
+void printMouseConfig(const MouseConfiguration &config) {
     if (config.mode == MouseMode::Buttons) {
-        std::cout << "  Buttons: ";
-        bool first = true;
-        for (auto button: config.buttons) {
-            if (!first) {
-                std::cout << " + ";
-            }
-            first = false;
-            switch (button) {
-                case MouseButton::Left:
-                    std::cout << "left";
-                    break;
-                case MouseButton::Right:
-                    std::cout << "right";
-                    break;
-                case MouseButton::Middle:
-                    std::cout << "middle";
-                    break;
-                case MouseButton::Back:
-                    std::cout << "back";
-                    break;
-                case MouseButton::Forward:
-                    std::cout << "forward";
-                    break;
-            };
-        }
-        std::cout << std::endl;
+        std::cout << "  Buttons: " << formatMouseButtons(config.buttons) << std::endl;
     } else {
         std::cout << "  Mouse move: " << (int) config.relativeX << "," << (int) config.relativeY << std::endl;
         std::cout << "  Mouse wheel: " << (int) config.wheelDelta << std::endl;
     }
 }
 
-void printGamepadConfig(GamepadConfiguration &config) {
-    std::cout << "  Button: ";
-    switch (config.button) {
-        case GamepadButton::Left:
-            std::cout << "Left";
-            break;
-        case GamepadButton::Right:
-            std::cout << "Right";
-            break;
-        case GamepadButton::Up:
-            std::cout << "Up";
-            break;
-        case GamepadButton::Down:
-            std::cout << "Down";
-            break;
-        case GamepadButton::Button1:
-            std::cout << "Button 1";
-            break;
-        case GamepadButton::Button2:
-            std::cout << "Button 2";
-            break;
-        case GamepadButton::Button3:
-            std::cout << "Button 3";
-            break;
-        case GamepadButton::Button4:
-            std::cout << "Button 4";
-            break;
-        case GamepadButton::Button5:
-            std::cout << "Button 5";
-            break;
-        case GamepadButton::Button6:
-            std::cout << "Button 6";
-            break;
-        case GamepadButton::Button7:
-            std::cout << "Button 7";
-            break;
-        case GamepadButton::Button8:
-            std::cout << "Button 8";
-            break;
-    };
-    std::cout << std::endl;
+void printGamepadConfig(const GamepadConfiguration &config) {
+    std::cout << "  Button: " << GamepadButtonTable.toDisplayName(config.button) << std::endl;
 }
 
-void printMediaConfig(MediaConfiguration &config) {
-    std::cout << "  Button: ";
-    switch (config.button) {
-        case MultiMediaButton::DecreaseVolume:
-            std::cout << "decrease_volume";
-            break;
-        case MultiMediaButton::IncreaseVolume:
-            std::cout << "increase_volume";
-            break;
-        case MultiMediaButton::Mute:
-            std::cout << "mute";
-            break;
-        case MultiMediaButton::Play:
-            std::cout << "play";
-            break;
-        case MultiMediaButton::Forward:
-            std::cout << "forward";
-            break;
-        case MultiMediaButton::Next:
-            std::cout << "next";
-            break;
-        case MultiMediaButton::Stop:
-            std::cout << "stop";
-            break;
-        case MultiMediaButton::OpenPlayer:
-            std::cout << "open_player";
-            break;
-        case MultiMediaButton::OpenHomepage:
-            std::cout << "open_homepage";
-            break;
-        case MultiMediaButton::StopWebPage:
-            std::cout << "stop_web_page";
-            break;
-        case MultiMediaButton::NavigateBack:
-            std::cout << "navigate_back";
-            break;
-        case MultiMediaButton::NavigateForward:
-            std::cout << "navigate_forward";
-            break;
-        case MultiMediaButton::Refresh:
-            std::cout << "refresh";
-            break;
-        case MultiMediaButton::OpenMyComputer:
-            std::cout << "open_my_computer";
-            break;
-        case MultiMediaButton::OpenMail:
-            std::cout << "open_mail";
-            break;
-        case MultiMediaButton::OpenCalc:
-            std::cout << "open_calculator";
-            break;
-        case MultiMediaButton::OpenSearch:
-            std::cout << "open_search";
-            break;
-        case MultiMediaButton::Shutdown:
-            std::cout << "shutdown";
-            break;
-        case MultiMediaButton::Sleep:
-            std::cout << "sleep";
-            break;
-    };
-    std::cout << std::endl;
+void printMediaConfig(const MediaConfiguration &config) {
+    std::cout << "  Button: " << MediaButtonTable.toDisplayName(config.button) << std::endl;
 }
@@ -1,5 +1,5 @@
 #pragma once
 
-#include "base.hpp"
+#include "configuration.hpp"
 
-void printConfig(SharedConfiguration config);
\ No newline at end of file
+void printConfig(const PedalConfiguration &config);
@@ -1,10 +1,9 @@
 #pragma once
 
 #include "base.hpp"
-#include <string>
-#include <vector>
+#include "../utils/enum_table.hpp"
 
-enum class GamepadButton {
+enum class GamepadButton : uint8_t {
     Left,
     Right,
     Up,
@@ -19,9 +18,26 @@ enum class GamepadButton {
     Button8,
 };
 
-class GamepadConfiguration : public BaseConfiguration {
-public:
-    ConfigurationType type() const override { return ConfigurationType::Gamepad; }
+/**
+ * Every gamepad button with its device code and names. Adding a button only needs an entry here and in the enum.
+ */
+inline constexpr auto GamepadButtonTable = makeEnumTable<GamepadButton>({
+    { GamepadButton::Left,    0x01, "left",    "Left" },
+    { GamepadButton::Right,   0x02, "right",   "Right" },
+    { GamepadButton::Up,      0x03, "up",      "Up" },
+    { GamepadButton::Down,    0x04, "down",    "Down" },
+    { GamepadButton::Button1, 0x05, "button1", "Button 1" },
+    { GamepadButton::Button2, 0x06, "button2", "Button 2" },
+    { GamepadButton::Button3, 0x07, "button3", "Button 3" },
+    { GamepadButton::Button4, 0x08, "button4", "Button 4" },
+    { GamepadButton::Button5, 0x09, "button5", "Button 5" },
+    { GamepadButton::Button6, 0x0a, "button6", "Button 6" },
+    { GamepadButton::Button7, 0x0b, "button7", "Button 7" },
+    { GamepadButton::Button8, 0x0c, "button8", "Button 8" },
+});
 
+static_assert(GamepadButtonTable.isValid());
+
+struct GamepadConfiguration {
     GamepadButton button;
 };
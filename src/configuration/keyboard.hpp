@@ -1,18 +1,52 @@
 #pragma once
 
 #include "base.hpp"
-#include <string>
-#include <vector>
+#include "keys.hpp"
+#include <array>
+#include <cstddef>
 
-enum class KeyMode {
+enum class KeyMode : uint8_t {
     OneShot,
     Standard
 };
 
-class KeyboardConfiguration : public BaseConfiguration {
-public:
-    ConfigurationType type() const override { return ConfigurationType::Keyboard; }
+/**
+ * Keys are held the way the device holds them: a modifier byte and up to 6 scan codes. They are only turned into
+ * names for display and when parsing arguments.
+ */
+struct KeyboardConfiguration {
+    // The non-modifier keys a packet can hold
+    static constexpr size_t MaxKeys = 6;
 
     KeyMode mode { KeyMode::Standard };
-    std::vector<std::string> keys;
+    // Bit N is set for the modifier with the key code KeyCode::FirstModifier + N
+    uint8_t modifiers { 0 };
+    // Scan codes, followed by zeros
+    std::array<uint8_t, MaxKeys> keys {};
+
+    size_t keyCount() const {
+        size_t count = 0;
+        while (count < keys.size() && keys[count] != 0) {
+            ++count;
+        }
+        return count;
+    }
+
+    /**
+     * Adds a key by its key code. Modifiers can always be added.
+     * @returns false if there is no room for another non-modifier key
+     */
+    bool addKey(uint8_t code) {
+        if (isModifierCode(code)) {
+            modifiers |= static_cast<uint8_t>(1 << (code - KeyCode::FirstModifier));
+            return true;
+        }
+
+        auto count = keyCount();
+        if (count == keys.size()) {
+            return false;
+        }
+        keys[count] = code;
+        return true;
+    }
 };
@@ -1,42 +1,52 @@
 #include "keys.hpp"
+#include "../utils/name_index.hpp"
 #include "../utils/usb_scancodes.hpp"
+#include <array>
+#include <iterator>
 
-bool isValidKey(const std::string_view &name) {
-    if (scanCodeFromKey(name) >= 0) {
-        return true;
+constexpr const char *ModifierNames[] = {
+    KeyName::LeftControl,
+    KeyName::LeftShift,
+    KeyName::LeftAlt,
+    KeyName::LeftSuper,
+    KeyName::RightControl,
+    KeyName::RightShift,
+    KeyName::RightAlt,
+    KeyName::RightSuper,
+};
+
+/**
+ * The name of every key by its USB HID usage code, modifiers included.
+ */
+constexpr auto makeKeyNames() {
+    std::array<const char *, 256> names {};
+    for (size_t code = 0; code < std::size(ScanCodeNames); ++code) {
+        names[code] = ScanCodeNames[code];
     }
-    if (isModifierKey(name)) {
-        return true;
+    for (size_t index = 0; index < std::size(ModifierNames); ++index) {
+        names[KeyCode::FirstModifier + index] = ModifierNames[index];
     }
 
-    return false;
+    return names;
+}
+
+constexpr auto KeyNames = makeKeyNames();
+constexpr NameIndex<512> KeyNameIndex(KeyNames.data(), KeyNames.size());
+static_assert(KeyNameIndex.longestProbe() <= 4);
+
+bool isValidKey(const std::string_view &name) {
+    return KeyNameIndex.find(name) >= 0;
 }
 
 bool isModifierKey(const std::string_view &name) {
-    if (name == KeyName::LeftControl) {
-        return true;
-    }
-    if (name == KeyName::LeftAlt) {
-        return true;
-    }
-    if (name == KeyName::LeftShift) {
-        return true;
-    }
-    if (name == KeyName::LeftSuper) {
-        return true;
-    }
-    if (name == KeyName::RightControl) {
-        return true;
-    }
-    if (name == KeyName::RightAlt) {
-        return true;
-    }
-    if (name == KeyName::RightShift) {
-        return true;
-    }
-    if (name == KeyName::RightSuper) {
-        return true;
-    }
+    auto code = KeyNameIndex.find(name);
+    return code >= 0 && isModifierCode(static_cast<uint8_t>(code));
+}
+
+int keyCodeFromName(const std::string_view &name) {
+    return KeyNameIndex.find(name);
+}
 
-    return false;
+const char *keyNameFromCode(uint8_t code) {
+    return KeyNames[code];
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 
 #define KEY(name, id) constexpr const char* name = #id
 
@@ -34,7 +35,34 @@ KEY(PageDown, page_down);
 KEY(PrintScreen, print_screen);
 }
 
+namespace KeyCode {
+// USB HID usage codes of the modifiers. Modifier N is bit N of the modifier byte in a keyboard report.
+constexpr uint8_t FirstModifier = 0xe0;
+constexpr uint8_t LeftControl = 0xe0;
+constexpr uint8_t LeftShift = 0xe1;
+constexpr uint8_t LeftAlt = 0xe2;
+constexpr uint8_t LeftSuper = 0xe3;
+constexpr uint8_t RightControl = 0xe4;
+constexpr uint8_t RightShift = 0xe5;
+constexpr uint8_t RightAlt = 0xe6;
+constexpr uint8_t RightSuper = 0xe7;
+}
+
+constexpr bool isModifierCode(uint8_t code) {
+    return code >= KeyCode::FirstModifier && code <= KeyCode::RightSuper;
+}
+
 bool isValidKey(const std::string_view &name);
 bool isModifierKey(const std::string_view &name);
 
+/**
+ * The USB HID usage code of a key, or -1 if there is no such key.
+ */
+int keyCodeFromName(const std::string_view &name);
+
+/**
+ * The name of a key from its USB HID usage code, or nullptr if it has none.
+ */
+const char *keyNameFromCode(uint8_t code);
+
 #undef KEY
@@ -1,10 +1,9 @@
 #pragma once
 
 #include "base.hpp"
-#include <string>
-#include <vector>
+#include "../utils/enum_table.hpp"
 
-enum class MultiMediaButton {
+enum class MultiMediaButton : uint8_t {
     DecreaseVolume,
     IncreaseVolume,
     Mute,
@@ -26,9 +25,33 @@ enum class MultiMediaButton {
     Sleep
 };
 
-class MediaConfiguration : public BaseConfiguration {
-public:
-    ConfigurationType type() const override { return ConfigurationType::Media; }
+/**
+ * Every media button with its device code and names. Adding a button only needs an entry here and in the enum.
+ */
+inline constexpr auto MediaButtonTable = makeEnumTable<MultiMediaButton>({
+    { MultiMediaButton::DecreaseVolume,  0x01, "decrease_volume",  "decrease_volume" },
+    { MultiMediaButton::IncreaseVolume,  0x02, "increase_volume",  "increase_volume" },
+    { MultiMediaButton::Mute,            0x03, "mute",             "mute" },
+    { MultiMediaButton::Play,            0x04, "play",             "play" },
+    { MultiMediaButton::Forward,         0x05, "forward",          "forward" },
+    { MultiMediaButton::Next,            0x06, "next",             "next" },
+    { MultiMediaButton::Stop,            0x07, "stop",             "stop" },
+    { MultiMediaButton::OpenPlayer,      0x08, "open_player",      "open_player" },
+    { MultiMediaButton::OpenHomepage,    0x09, "open_homepage",    "open_homepage" },
+    { MultiMediaButton::StopWebPage,     0x0a, "stop_webpage",     "stop_web_page" },
+    { MultiMediaButton::NavigateBack,    0x0b, "navigate_back",    "navigate_back" },
+    { MultiMediaButton::NavigateForward, 0x0c, "navigate_forward", "navigate_forward" },
+    { MultiMediaButton::Refresh,         0x0d, "refresh",          "refresh" },
+    { MultiMediaButton::OpenMyComputer,  0x0e, "open_my_computer", "open_my_computer" },
+    { MultiMediaButton::OpenMail,        0x0f, "open_mail",        "open_mail" },
+    { MultiMediaButton::OpenCalc,        0x10, "open_calculator",  "open_calculator" },
+    { MultiMediaButton::OpenSearch,      0x11, "open_search",      "open_search" },
+    { MultiMediaButton::Shutdown,        0x12, "shutdown",         "shutdown" },
+    { MultiMediaButton::Sleep,           0x13, "sleep",            "sleep" },
+});
 
+static_assert(MediaButtonTable.isValid());
+
+struct MediaConfiguration {
     MultiMediaButton button;
 };
@@ -0,0 +1,36 @@
+#include "mouse.hpp"
+
+// Indexed by MouseButton
+const std::string_view MouseButtonNames[MouseButtonCount] = {
+    "left",
+    "right",
+    "middle",
+    "back",
+    "forward",
+};
+
+std::string_view getMouseButtonName(MouseButton button) {
+    return MouseButtonNames[static_cast<size_t>(button)];
+}
+
+std::optional<MouseButton> parseMouseButton(std::string_view name) {
+    for (size_t index = 0; index < MouseButtonCount; ++index) {
+        if (MouseButtonNames[index] == name) {
+            return static_cast<MouseButton>(index);
+        }
+    }
+
+    return {};
+}
+
+std::string formatMouseButtons(MouseButtons buttons, std::string_view separator) {
+    std::string formatted;
+    for (auto button: buttons) {
+        if (!formatted.empty()) {
+            formatted.append(separator);
+        }
+        formatted.append(getMouseButtonName(button));
+    }
+
+    return formatted;
+}
@@ -1,16 +1,22 @@
 #pragma once
 
 #include "base.hpp"
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
 #include <string>
-#include <vector>
-#include <unordered_set>
+#include <string_view>
 
-enum class MouseMode {
+enum class MouseMode : uint8_t {
     Buttons,
     Axis,
 };
 
-enum class MouseButton {
+/**
+ * Mouse buttons, in the order of their bits in a mouse report.
+ */
+enum class MouseButton : uint8_t {
     Left,
     Right,
     Middle,
@@ -18,13 +24,128 @@ enum class MouseButton {
     Forward,
 };
 
-class MouseConfiguration : public BaseConfiguration {
+constexpr size_t MouseButtonCount = 5;
+
+/**
+ * A set of mouse buttons stored as a bitmask, with bit N for MouseButton N. Iterates in button order.
+ */
+class MouseButtons {
 public:
-    ConfigurationType type() const override { return ConfigurationType::Mouse; }
+    static constexpr uint8_t AllBits = (1 << MouseButtonCount) - 1;
+
+    class Iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef MouseButton value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const MouseButton *pointer;
+        typedef MouseButton reference;
+
+        constexpr Iterator(uint8_t remaining) : remaining(remaining) {}
+
+        constexpr MouseButton operator*() const {
+            uint8_t index = 0;
+            while ((remaining & (1 << index)) == 0) {
+                ++index;
+            }
+            return static_cast<MouseButton>(index);
+        }
+
+        constexpr Iterator &operator++() {
+            // Drop the lowest button
+            remaining &= static_cast<uint8_t>(remaining - 1);
+            return *this;
+        }
+
+        constexpr Iterator operator++(int) {
+            auto previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        constexpr bool operator==(const Iterator &other) const { return remaining == other.remaining; }
+        constexpr bool operator!=(const Iterator &other) const { return remaining != other.remaining; }
+    private:
+        uint8_t remaining;
+    };
+
+    constexpr MouseButtons() = default;
+
+    constexpr MouseButtons(std::initializer_list<MouseButton> buttons) {
+        for (auto button: buttons) {
+            insert(button);
+        }
+    }
+
+    /**
+     * Bits which do not belong to a button are dropped.
+     */
+    static constexpr MouseButtons fromBits(uint8_t bits) {
+        MouseButtons buttons;
+        buttons.mask = bits & AllBits;
+        return buttons;
+    }
+
+    constexpr uint8_t bits() const { return mask; }
+
+    constexpr bool empty() const { return mask == 0; }
+
+    constexpr size_t size() const {
+        size_t count = 0;
+        for (auto remaining = mask; remaining != 0; remaining &= static_cast<uint8_t>(remaining - 1)) {
+            ++count;
+        }
+        return count;
+    }
+
+    constexpr bool contains(MouseButton button) const { return (mask & bit(button)) != 0; }
+
+    constexpr MouseButtons &insert(MouseButton button) {
+        mask |= bit(button);
+        return *this;
+    }
+
+    constexpr MouseButtons &erase(MouseButton button) {
+        mask &= static_cast<uint8_t>(~bit(button));
+        return *this;
+    }
+
+    constexpr Iterator begin() const { return { mask }; }
+    constexpr Iterator end() const { return { 0 }; }
+
+    constexpr MouseButtons operator|(MouseButtons other) const { return fromBits(mask | other.mask); }
+    constexpr MouseButtons operator&(MouseButtons other) const { return fromBits(mask & other.mask); }
+    // The buttons in this set which are not in the other
+    constexpr MouseButtons operator-(MouseButtons other) const { return fromBits(mask & ~other.mask); }
+
+    constexpr MouseButtons &operator|=(MouseButtons other) { return *this = *this | other; }
+    constexpr MouseButtons &operator&=(MouseButtons other) { return *this = *this & other; }
+    constexpr MouseButtons &operator-=(MouseButtons other) { return *this = *this - other; }
+
+    constexpr bool operator==(MouseButtons other) const { return mask == other.mask; }
+    constexpr bool operator!=(MouseButtons other) const { return mask != other.mask; }
+private:
+    uint8_t mask { 0 };
+
+    static constexpr uint8_t bit(MouseButton button) { return static_cast<uint8_t>(1 << static_cast<int>(button)); }
+};
+
+/**
+ * The name of a button as used on the command line.
+ */
+std::string_view getMouseButtonName(MouseButton button);
+
+std::optional<MouseButton> parseMouseButton(std::string_view name);
+
+/**
+ * Lists the buttons by name in button order, eg. "left + back".
+ */
+std::string formatMouseButtons(MouseButtons buttons, std::string_view separator = " + ");
 
-    MouseMode mode;
+struct MouseConfiguration {
+    MouseMode mode { MouseMode::Buttons };
 
-    std::unordered_set<MouseButton> buttons;
+    MouseButtons buttons;
     int8_t relativeX { 0 };
     int8_t relativeY { 0 };
     int8_t wheelDelta { 0 };
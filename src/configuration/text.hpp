@@ -1,11 +1,25 @@
 #pragma once
 
 #include "base.hpp"
-#include <string>
+#include <algorithm>
+#include <array>
+#include <string_view>
 
-class TextConfiguration : public BaseConfiguration {
-public:
-    ConfigurationType type() const override { return ConfigurationType::Text; }
+struct TextConfiguration {
+    // The most a single config packet can hold
+    static constexpr size_t MaxLength = 38;
 
-    std::string text;
+    // Always null terminated
+    std::array<char, MaxLength + 1> text {};
+
+    std::string_view getText() const { return text.data(); }
+
+    /**
+     * Replaces the text, keeping only the first MaxLength characters.
+     */
+    void setText(std::string_view value) {
+        auto length = std::min(value.size(), MaxLength);
+        std::copy_n(value.begin(), length, text.begin());
+        text[length] = '\0';
+    }
 };
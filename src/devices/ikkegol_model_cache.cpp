@@ -0,0 +1,174 @@
+#include "ikkegol_model_cache.hpp"
+#include "ikkegol_capabilities.hpp"
+#include "../utils/string_utils.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+const char *CacheFileName = "pedalctl-models";
+
+// Devices may be probed concurrently so all access to the cache goes through this lock
+std::mutex cacheLock;
+std::optional<std::map<ModelCacheKey, ModelCacheEntry>> cacheEntries;
+
+std::optional<std::string> getCachePath() {
+    // The runtime directory is cleared on logout / reboot which is also when devices get re-enumerated
+    auto runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir == nullptr || runtimeDir[0] == '\0') {
+        return {};
+    }
+
+    return std::string(runtimeDir) + "/" + CacheFileName;
+}
+
+bool isCacheable(const std::string &value) {
+    return !value.empty() && std::all_of(value.begin(), value.end(), [](unsigned char ch) { return ch >= ' '; });
+}
+
+/**
+ * Only entries for supported models are kept. Anything else came from a handshake that went wrong, and trusting it
+ * would skip the handshake that could correct it.
+ */
+bool isCacheable(const ModelCacheEntry &entry) {
+    return isCacheable(entry.model) && isCacheable(entry.version) && getModelCapabilities(entry.model).has_value();
+}
+
+std::map<ModelCacheKey, ModelCacheEntry> readCacheFile(const std::string &path) {
+    std::map<ModelCacheKey, ModelCacheEntry> entries;
+
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        auto fields = split(line, '\t');
+        if (fields.size() != 5) {
+            continue;
+        }
+
+        try {
+            ModelCacheKey key {
+                fields[0],
+                static_cast<uint32_t>(std::stoul(fields[1])),
+                static_cast<uint32_t>(std::stoul(fields[2], nullptr, 16)),
+            };
+            ModelCacheEntry entry { fields[3], fields[4] };
+            if (isCacheable(entry)) {
+                entries[key] = entry;
+            }
+        } catch (std::exception &error) {
+            // Ignore malformed entries
+        }
+    }
+
+    return entries;
+}
+
+std::map<ModelCacheKey, ModelCacheEntry> &loadCache() {
+    if (cacheEntries) {
+        return *cacheEntries;
+    }
+
+    auto path = getCachePath();
+    if (path) {
+        cacheEntries = readCacheFile(*path);
+    } else {
+        cacheEntries.emplace();
+    }
+
+    return *cacheEntries;
+}
+
+void saveCache(const std::string &path, const std::map<ModelCacheKey, ModelCacheEntry> &entries) {
+    std::ostringstream contents;
+    for (auto &[key, entry]: entries) {
+        contents << key.portPath << '\t' << key.address << '\t' << std::hex << key.bcdDevice << std::dec << '\t'
+            << entry.model << '\t' << entry.version << '\n';
+    }
+    auto data = contents.str();
+
+    // Write to a temporary file first so other instances never read a partial cache. Each instance has its own so
+    // two saving at once do not write into the same file.
+    std::string tempPath = path + ".XXXXXX";
+    auto fd = mkstemp(tempPath.data());
+    if (fd < 0) {
+        return;
+    }
+
+    size_t written = 0;
+    while (written < data.size()) {
+        auto result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0) {
+            break;
+        }
+        written += static_cast<size_t>(result);
+    }
+
+    if (close(fd) < 0 || written < data.size()) {
+        std::remove(tempPath.c_str());
+        return;
+    }
+
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+    }
+}
+
+std::optional<ModelCacheEntry> lookupCachedModel(const ModelCacheKey &key) {
+    std::lock_guard lock(cacheLock);
+
+    auto &entries = loadCache();
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return {};
+    }
+
+    return it->second;
+}
+
+void storeCachedModel(const ModelCacheKey &key, const ModelCacheEntry &entry) {
+    if (!isCacheable(entry)) {
+        return;
+    }
+
+    std::lock_guard lock(cacheLock);
+
+    auto &entries = loadCache();
+
+    auto path = getCachePath();
+    // Held until the new cache is in place, so instances saving at once take turns
+    int lockFd = -1;
+    if (path) {
+        lockFd = open((*path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (lockFd >= 0) {
+            flock(lockFd, LOCK_EX);
+        }
+
+        // Other instances may have saved since the cache was read. Start from what they wrote so their entries are
+        // kept.
+        entries = readCacheFile(*path);
+    }
+
+    // Anything else cached for this port belongs to a previous enumeration
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->first.portPath == key.portPath) {
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    entries[key] = entry;
+    if (path) {
+        saveCache(*path, entries);
+    }
+
+    if (lockFd >= 0) {
+        close(lockFd);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <tuple>
+#include <cstdint>
+
+/**
+ * Identifies a single enumeration of a device.
+ * The bus address changes whenever the device is re-enumerated, so a stale entry is never returned for a
+ * re-plugged or reset device.
+ */
+struct ModelCacheKey {
+    std::string portPath;
+    uint32_t address;
+    uint32_t bcdDevice;
+
+    bool operator<(const ModelCacheKey &other) const {
+        return std::tie(portPath, address, bcdDevice) < std::tie(other.portPath, other.address, other.bcdDevice);
+    }
+};
+
+struct ModelCacheEntry {
+    std::string model;
+    std::string version;
+};
+
+/**
+ * Looks up the model and version previously read from a device.
+ */
+std::optional<ModelCacheEntry> lookupCachedModel(const ModelCacheKey &key);
+
+void storeCachedModel(const ModelCacheKey &key, const ModelCacheEntry &entry);
@@ -1,59 +1,128 @@
 #include "ikkegol_pedal.hpp"
-#include "../utils/usb_interface_lock.hpp"
+#include "ikkegol_usb_transport.hpp"
+#include "ikkegol_simulator.hpp"
+#include "ikkegol_trace.hpp"
 #include "ikkegol_protocol.hpp"
-#include "../configuration/keyboard.hpp"
+#include "ikkegol_model_cache.hpp"
 #include "../utils/errors.hpp"
+#include "../utils/command_line.hpp"
 #include <cstring>
 #include <chrono>
 #include <thread>
 #include <cassert>
+#include <atomic>
+#include <algorithm>
+#include <cctype>
 
 const uint16_t VendorId = 0x1a86;
 const uint16_t ProductId = 0xe026;
-const int ConfigInterface = 1;
-const uint8_t ConfigEndpoint = 0x02;
+const size_t MaxProbeThreads = 16;
+// Used as-is when the polling interval is unknown, and as the upper limit otherwise
+const std::chrono::milliseconds TransferTimeout(100);
+const std::chrono::milliseconds HandshakeTimeout(1000);
+// The number of polls the device gets to respond, and the least time it gets regardless
+const uint32_t TransferTimeoutPolls = 10;
+const std::chrono::milliseconds MinTransferTimeout(20);
+const uint32_t HandshakeTimeoutPolls = 50;
+const std::chrono::milliseconds MinHandshakeTimeout(250);
+// How many times a verified save rewrites what did not read back correctly before giving up
+const uint32_t MaxVerifyRewrites = 2;
+
+SharedIkkegolPedal makeIkkegolPedal(std::unique_ptr<IkkegolTransport> transport, int id) {
+    return std::make_shared<IkkegolPedal>(recordTransportIfRequested(std::move(transport)), id);
+}
+
+/**
+ * Devices which are not attached over USB. These always come after real ones.
+ */
+std::vector<std::unique_ptr<IkkegolTransport>> createVirtualTransports() {
+    auto transports = createSimulatedTransports();
+    for (auto &transport: createReplayTransports()) {
+        transports.push_back(std::move(transport));
+    }
+
+    return transports;
+}
 
 std::vector<SharedIkkegolPedal> discoverIkkegolDevices() {
     std::vector<SharedIkkegolPedal> devices;
 
     libusb_device **list;
-
     auto deviceCount = libusb_get_device_list(nullptr, &list);
-    if (deviceCount < 0) {
-        // TODO: it would be better to return an error here
-        return {};
-    }
-
-    int nextId = 1;
-    for (auto index = 0; index < deviceCount; ++index) {
-        libusb_device *device = list[index];
-        libusb_device_descriptor descriptor;
-        if (libusb_get_device_descriptor(device, &descriptor) < 0) {
-            continue;
-        }
-        if (descriptor.idVendor == VendorId && descriptor.idProduct == ProductId) {
-            auto footPedal = std::make_shared<IkkegolPedal>(device, nextId);
-            devices.push_back(footPedal);
-            ++nextId;
+    if (deviceCount >= 0) {
+        for (auto index = 0; index < deviceCount; ++index) {
+            libusb_device *device = list[index];
+            libusb_device_descriptor descriptor;
+            if (libusb_get_device_descriptor(device, &descriptor) < 0) {
+                continue;
+            }
+            if (descriptor.idVendor == VendorId && descriptor.idProduct == ProductId) {
+                // Devices are not opened here. IDs are assigned by enumeration order so they stay stable.
+                devices.push_back(makeIkkegolPedal(
+                    std::make_unique<IkkegolUSBTransport>(device), static_cast<int>(devices.size() + 1)
+                ));
+            }
         }
+
+        libusb_free_device_list(list, 1);
     }
 
-    libusb_free_device_list(list, 1);
+    for (auto &transport: createVirtualTransports()) {
+        devices.push_back(makeIkkegolPedal(std::move(transport), static_cast<int>(devices.size() + 1)));
+    }
 
     return devices;
 }
 
-SharedIkkegolPedal findIkkegolDevice(uint32_t id) {
+void probeIkkegolDevices(const std::vector<SharedIkkegolPedal> &devices) {
+    // Probing a device is mostly spent waiting on the model / version handshake.
+    // Probe all of them at once so it takes as long as the slowest device rather than the sum of all.
+    std::atomic<size_t> nextIndex { 0 };
+
+    auto worker = [&]() {
+        for (auto index = nextIndex++; index < devices.size(); index = nextIndex++) {
+            devices[index]->probe();
+        }
+    };
+
+    auto threadCount = std::min(devices.size(), MaxProbeThreads);
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (size_t thread = 0; thread < threadCount; ++thread) {
+        workers.emplace_back(worker);
+    }
+    for (auto &thread: workers) {
+        thread.join();
+    }
+}
+
+SharedIkkegolPedal findIkkegolDevice(const std::string_view &address) {
+    if (address.empty()) {
+        return {};
+    }
+
+    // A purely numeric address is an ID as assigned by discoverIkkegolDevices(), otherwise it is a port path
+    std::optional<uint32_t> id;
+    if (std::all_of(address.begin(), address.end(), [](unsigned char ch) { return std::isdigit(ch); })) {
+        auto parsed = parseInt(address);
+        if (!parsed || *parsed < 1) {
+            return {};
+        }
+        id = *parsed;
+    }
+
     libusb_device **list;
     SharedIkkegolPedal found;
 
     auto deviceCount = libusb_get_device_list(nullptr, &list);
     if (deviceCount < 0) {
-        // TODO: it would be better to return an error here
-        return {};
+        deviceCount = 0;
+        list = nullptr;
     }
 
-    int nextId = 1;
+    // Only descriptors and port numbers are inspected here. The device itself is only opened once it has been
+    // identified as the target, so the cost does not depend on where it is in the list.
+    uint32_t nextId = 1;
     for (auto index = 0; index < deviceCount; ++index) {
         libusb_device *device = list[index];
         libusb_device_descriptor descriptor;
@@ -61,38 +130,153 @@ SharedIkkegolPedal findIkkegolDevice(uint32_t id) {
             continue;
         }
         if (descriptor.idVendor == VendorId && descriptor.idProduct == ProductId) {
-            auto footPedal = std::make_shared<IkkegolPedal>(device, nextId);
-            if (footPedal->getId() == id) {
-                found = footPedal;
+            bool matches;
+            if (id) {
+                matches = (nextId == *id);
+            } else {
+                matches = (getUSBPortPath(device) == address);
+            }
+
+            if (matches) {
+                found = makeIkkegolPedal(std::make_unique<IkkegolUSBTransport>(device), nextId);
                 break;
             }
             ++nextId;
         }
     }
 
-    libusb_free_device_list(list, 1);
+    if (list != nullptr) {
+        libusb_free_device_list(list, 1);
+    }
+
+    if (!found) {
+        for (auto &transport: createVirtualTransports()) {
+            if ((id && nextId == *id) || (!id && transport->getPortPath() == address)) {
+                found = makeIkkegolPedal(std::move(transport), nextId);
+                break;
+            }
+            ++nextId;
+        }
+    }
 
     return found;
 }
 
-IkkegolPedal::IkkegolPedal(libusb_device *device, int id) : id(id) {
-    auto result = libusb_open(device, &handle);
+IkkegolPedal::IkkegolPedal(std::unique_ptr<IkkegolTransport> transport, int id)
+    : transport(std::move(transport)), id(id), transferTimeout(TransferTimeout), handshakeTimeout(HandshakeTimeout) {
+    // The idle timeout is measured between completions, so that is what the retry policy learns from
+    this->transport->setCompletionListener([this](USBTransfer &) {
+        auto now = std::chrono::steady_clock::now();
+        retryPolicy.recordResponse(std::chrono::duration_cast<std::chrono::microseconds>(now - lastCompletion));
+        lastCompletion = now;
+    });
+}
+
+IkkegolPedal::~IkkegolPedal() = default;
+
+bool IkkegolPedal::open() {
+    if (opened) {
+        return true;
+    }
+    if (openAttempted) {
+        return false;
+    }
+
+    openAttempted = true;
+    auto result = transport->open();
     updateLastError(result);
 
-    if (handle != nullptr) {
-        init();
+    opened = (result >= 0);
+    if (opened) {
+        applyEndpointTiming();
     }
+    return opened;
 }
 
-IkkegolPedal::~IkkegolPedal() {
-    if (handle) {
-        libusb_close(handle);
+bool IkkegolPedal::acquireInterface(bool reattachDriver) {
+    if (interfaceClaims > 0) {
+        ++interfaceClaims;
+        return true;
     }
+
+    if (!open()) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = transport->claimInterface(reattachDriver);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    claimStats.elapsed += std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+
+    if (result < 0) {
+        updateLastError(result);
+        return false;
+    }
+
+    ++claimStats.claims;
+    ++interfaceClaims;
+    return true;
+}
+
+void IkkegolPedal::releaseInterface() {
+    if (--interfaceClaims > 0) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    transport->releaseInterface();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    claimStats.elapsed += std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+}
+
+/**
+ * Scales a timeout to the number of polls the device should need, within the fixed limits.
+ */
+std::chrono::milliseconds timeoutForPolls(
+    std::chrono::microseconds interval, uint32_t polls, std::chrono::milliseconds minimum,
+    std::chrono::milliseconds maximum
+) {
+    return std::clamp(std::chrono::ceil<std::chrono::milliseconds>(interval * polls), minimum, maximum);
+}
+
+void IkkegolPedal::applyEndpointTiming() {
+    auto timing = transport->getEndpointTiming();
+    if (!timing) {
+        return;
+    }
+
+    // Exchanges go in both directions, so they run at the pace of the slower endpoint
+    auto interval = std::max(timing->inInterval, timing->outInterval);
+    transferTimeout = timeoutForPolls(interval, TransferTimeoutPolls, MinTransferTimeout, TransferTimeout);
+    handshakeTimeout = timeoutForPolls(interval, HandshakeTimeoutPolls, MinHandshakeTimeout, HandshakeTimeout);
+    retryPolicy.setPollInterval(interval);
+}
+
+bool IkkegolPedal::probe() {
+    if (!probed) {
+        probed = true;
+        if (open()) {
+            init();
+        }
+    }
+
+    return opened;
 }
 
 void IkkegolPedal::init() {
-    libusb_set_auto_detach_kernel_driver(handle, 1);
-    readModelAndVersion();
+    auto cacheKey = transport->getCacheKey();
+    std::optional<ModelCacheEntry> cached;
+    if (cacheKey) {
+        cached = lookupCachedModel(*cacheKey);
+    }
+
+    if (cached) {
+        model = cached->model;
+        version = cached->version;
+    } else if (readModelAndVersion() && cacheKey) {
+        storeCachedModel(*cacheKey, { model, version });
+    }
+
     auto caps = getModelCapabilities(model);
     if (caps) {
         capabilities = *caps;
@@ -107,98 +291,165 @@ void IkkegolPedal::init() {
     pedalTriggerTypeModified.resize(capabilities.pedals);
     std::fill(pedalModified.begin(), pedalModified.end(), false);
     std::fill(pedalTriggerTypeModified.begin(), pedalTriggerTypeModified.end(), false);
+
+    devicePackets.clear();
+    devicePackets.resize(capabilities.pedals);
+    deviceTriggerModes.reset();
+}
+
+template<typename Attempt>
+bool IkkegolPedal::runStep(
+    std::string_view step, bool idempotent, std::chrono::milliseconds defaultTimeout, Attempt &&attempt
+) {
+    for (uint32_t attemptNumber = 1;; ++attemptNumber) {
+        auto timeout = retryPolicy.getTimeout(defaultTimeout, attemptNumber);
+        auto result = attempt(timeout);
+        if (result >= 0) {
+            return true;
+        }
+
+        auto backoff = retryPolicy.onFailure(step, attemptNumber, result, idempotent, timeout);
+        if (!backoff) {
+            updateLastError(result);
+            return false;
+        }
+
+        if (result == LIBUSB_ERROR_PIPE) {
+            transport->clearHalt();
+        }
+        std::this_thread::sleep_for(*backoff);
+    }
 }
 
 bool IkkegolPedal::readModelAndVersion() {
-    constexpr uint32_t MaxAttempts = 10;
+    constexpr uint32_t MaxReads = 10;
     constexpr uint32_t MaxSections = 4;
 
-    USBInterfaceLock interfaceLock(handle, ConfigInterface);
+    IkkegolSession session(*this);
+    if (!session.isClaimed()) {
+        return false;
+    }
 
     uint8_t request[8] = { 0x01, 0x83, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00 };
 
-    int wrote;
-    auto result = libusb_interrupt_transfer(
-        handle, ConfigEndpoint | LIBUSB_ENDPOINT_OUT, request, sizeof(request), &wrote, 100
-    );
-    if (wrote < 0 || result < 0) {
-        updateLastError(result);
-        return false;
-    }
+    auto start = std::chrono::steady_clock::now();
+
+    auto succeeded = runStep("read version", true, handshakeTimeout, [&](std::chrono::milliseconds timeout) {
+        uint8_t versionBuffer[32] {};
+        uint32_t sectionsRead = 0;
+        uint32_t reads = 0;
+        int pageError = 0;
+        bool terminated = false;
+
+        // Each section is requested as soon as the previous one arrives. The exchange is over once a section is
+        // padded with zeros (the end of the string) or all sections have been read.
+        IkkegolTransport::Callback onSection;
+        auto readSection = [&](USBTransfer &transfer) {
+            ++reads;
+            if (transfer.actualLength > 0) {
+                if (transfer.actualLength < 8) {
+                    // Part of the section is missing
+                    pageError = LIBUSB_ERROR_IO;
+                    return;
+                }
+
+                ++sectionsRead;
+                if (std::memchr(transfer.buffer, 0, transfer.actualLength) != nullptr) {
+                    terminated = true;
+                    return;
+                }
+            }
 
-    uint8_t versionBuffer[32];
-    uint8_t buffer[8];
-    uint32_t sectionsRead = 0;
-    uint32_t attempts = 0;
+            if (sectionsRead < MaxSections && reads < MaxReads) {
+                submitIn(&versionBuffer[sectionsRead * 8], 8, onSection);
+            }
+        };
+        onSection = readSection;
 
-    do {
-        int read;
-        libusb_interrupt_transfer(handle, ConfigEndpoint | LIBUSB_ENDPOINT_IN, buffer, sizeof(buffer), &read, 100);
-        if (read > 0) {
-            std::memcpy(&versionBuffer[sectionsRead * 8], buffer, read);
-            ++sectionsRead;
-        } else if (read == 0 && sectionsRead > 0) {
-            break;
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        submitOut(request, sizeof(request));
+        submitIn(versionBuffer, 8, onSection);
+
+        auto result = wait(timeout);
+        if (result < 0) {
+            return result;
+        }
+        if (pageError < 0) {
+            return pageError;
+        }
+        // Without the zero padding, or all of the sections, the end of the string went missing
+        if (!terminated && sectionsRead < MaxSections) {
+            return static_cast<int>(LIBUSB_ERROR_IO);
         }
 
-        ++attempts;
-    } while (sectionsRead < MaxSections && attempts < MaxAttempts);
+        std::string decoded(reinterpret_cast<char *>(versionBuffer), sectionsRead * 8);
+        // The final section is padded with zeros
+        decoded.erase(decoded.find_last_not_of('\0') + 1);
 
-    if (sectionsRead == 0) {
-        return false;
-    }
+        auto separator = decoded.find_last_of('_');
+        if (separator == std::string::npos || separator == 0) {
+            // Unexpected format, or the start of it went missing
+            return static_cast<int>(LIBUSB_ERROR_IO);
+        }
+        model = decoded.substr(0, separator);
 
-    std::string decoded(reinterpret_cast<char *>(versionBuffer), sectionsRead * 8);
-    auto separator = decoded.find_last_of('_');
-    if (separator == std::string::npos) {
-        // Unexpected format
-        return false;
-    }
-    model = decoded.substr(0, separator);
+        if (decoded[separator + 1] == 'V') {
+            ++separator;
+        }
 
-    if (decoded[separator + 1] == 'V') {
-        ++separator;
-    }
+        version = decoded.substr(separator + 1);
+        return 0;
+    });
 
-    version = decoded.substr(separator + 1);
-    return true;
+    handshakeLatency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return succeeded;
 }
 
-bool IkkegolPedal::load() {
-    if (!isValid()) {
+bool IkkegolPedal::load(uint32_t pedalMask, bool triggerModes) {
+    if (!probe()) {
         return false;
     }
-    USBInterfaceLock interfaceLock(handle, ConfigInterface);
-
-    for (auto pedal = 0; pedal < capabilities.pedals; ++pedal) {
-        pedalConfiguration[pedal] = readConfiguration(pedal + capabilities.firstPedalIndex);
+    IkkegolSession session(*this);
+    if (!session.isClaimed()) {
+        return false;
     }
 
-    std::fill(pedalModified.begin(), pedalModified.end(), false);
-    std::fill(pedalTriggerTypeModified.begin(), pedalTriggerTypeModified.end(), false);
+    for (uint32_t pedal = 0; pedal < capabilities.pedals; ++pedal) {
+        if ((pedalMask & (1u << pedal)) == 0) {
+            continue;
+        }
 
-    if (!readPedalTriggerModes()) {
+        ConfigPacket packet;
+        if (!readConfiguration(pedal + capabilities.firstPedalIndex, packet)) {
+            return false;
+        }
+
+        pedalConfiguration[pedal] = parseConfig(packet);
+        devicePackets[pedal] = packet;
+        pedalModified[pedal] = false;
+        pedalTriggerTypeModified[pedal] = false;
+    }
+
+    if (triggerModes && !readPedalTriggerModes()) {
         return false;
     }
 
     return true;
 }
 
-const SharedConfiguration IkkegolPedal::getConfiguration(uint32_t pedal) const {
+const PedalConfiguration &IkkegolPedal::getConfiguration(uint32_t pedal) const {
+    static const PedalConfiguration unconfigured;
+
     if (pedal < pedalConfiguration.size()) {
         return pedalConfiguration[pedal];
     }
-    return {};
+    return unconfigured;
 }
 
-void IkkegolPedal::setConfiguration(uint32_t pedal, const SharedConfiguration &config) {
+void IkkegolPedal::setConfiguration(uint32_t pedal, const Configuration &config) {
     assert(pedal < pedalConfiguration.size());
-    assert(config);
 
     auto &oldConfig = pedalConfiguration[pedal];
-    if (oldConfig && oldConfig->trigger != config->trigger) {
+    if (oldConfig && oldConfig->trigger != config.trigger) {
         pedalTriggerTypeModified[pedal] = true;
     }
 
@@ -206,40 +457,61 @@ void IkkegolPedal::setConfiguration(uint32_t pedal, const SharedConfiguration &c
     pedalModified[pedal] = true;
 }
 
-bool IkkegolPedal::readPedalTriggerModes() {
+/**
+ * Responses are always made up of whole pages. Flags any page that arrived short.
+ */
+auto checkPageLength(int &error) {
+    return [&error](USBTransfer &transfer) {
+        if (transfer.actualLength != 8) {
+            error = LIBUSB_ERROR_IO;
+        }
+    };
+}
+
+bool IkkegolPedal::readTriggerModeBlock(TriggerModeBlock &block) {
     uint8_t request[8] = { 0x01, 0x86, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
 
-    int wrote;
-    auto result = libusb_interrupt_transfer(
-        handle, ConfigEndpoint | LIBUSB_ENDPOINT_OUT, request, sizeof(request), &wrote, 100
-    );
-    if (wrote < 0 || result < 0) {
-        updateLastError(result);
-        return false;
-    }
+    return runStep("read trigger modes", true, transferTimeout, [&](std::chrono::milliseconds timeout) {
+        block.fill(0);
+        int pageError = 0;
+        auto checkPage = checkPageLength(pageError);
 
-    uint8_t buffer[16];
-    int read;
-    result = libusb_interrupt_transfer(handle, ConfigEndpoint | LIBUSB_ENDPOINT_IN, buffer, 8, &read, 100);
-    if (result < 0) {
-        updateLastError(result);
-        return false;
-    }
+        auto onFirstPage = [&](USBTransfer &transfer) {
+            checkPage(transfer);
+            if (pageError == 0 && block[0] > 8) {
+                submitIn(&block[8], 8, checkPage);
+            }
+        };
 
-    if (buffer[0] > 8) {
-        result = libusb_interrupt_transfer(handle, ConfigEndpoint | LIBUSB_ENDPOINT_IN, &buffer[8], 8, &read, 100);
+        submitOut(request, sizeof(request));
+        submitIn(block.data(), 8, onFirstPage);
+
+        auto result = wait(timeout);
         if (result < 0) {
-            updateLastError(result);
-            return false;
+            return result;
+        }
+        if (pageError < 0 || block[0] > block.size()) {
+            return pageError < 0 ? pageError : static_cast<int>(LIBUSB_ERROR_IO);
         }
+
+        return 0;
+    });
+}
+
+bool IkkegolPedal::readPedalTriggerModes() {
+    TriggerModeBlock buffer;
+    if (!readTriggerModeBlock(buffer)) {
+        return false;
     }
 
-    for (auto pedal = 0; pedal < capabilities.pedals; ++pedal) {
+    deviceTriggerModes = buffer;
+
+    for (uint32_t pedal = 0; pedal < capabilities.pedals; ++pedal) {
         auto mode = static_cast<TriggerMode>(buffer[pedal + capabilities.firstPedalIndex + 1]);
         auto &config = pedalConfiguration[pedal];
 
-        if (!config) {
-            // Pedal not-configured
+        if (!config || pedalModified[pedal]) {
+            // Pedal not-configured, or changed since it was loaded and not yet saved
             continue;
         }
 
@@ -256,48 +528,63 @@ bool IkkegolPedal::readPedalTriggerModes() {
     return true;
 }
 
-SharedConfiguration IkkegolPedal::readConfiguration(uint32_t pedal) {
+bool IkkegolPedal::readConfiguration(uint32_t pedal, ConfigPacket &packet) {
     uint8_t request[8] = { 0x01, 0x82, 0x08, static_cast<uint8_t>(pedal + 1), 0x00, 0x00, 0x00, 0x00 };
 
-    int wrote;
-    auto result = libusb_interrupt_transfer(
-        handle, ConfigEndpoint | LIBUSB_ENDPOINT_OUT, request, sizeof(request), &wrote, 100
-    );
-    if (wrote < 0 || result < 0) {
-        updateLastError(result);
-        return {};
-    }
+    return runStep("read configuration", true, transferTimeout, [&](std::chrono::milliseconds timeout) {
+        // Read straight into the packet. Any page left over from a previous attempt must not be mistaken for data.
+        packet.fill(0);
+        int pageError = 0;
+        auto checkPage = checkPageLength(pageError);
 
-    uint8_t buffer[40];
-    std::fill_n(buffer, sizeof(buffer), 0);
+        auto onFirstPage = [&](USBTransfer &transfer) {
+            checkPage(transfer);
+            if (pageError < 0 || packet[0] > packet.size()) {
+                return;
+            }
 
-    int read;
-    result = libusb_interrupt_transfer(handle, ConfigEndpoint | LIBUSB_ENDPOINT_IN, buffer, 8, &read, 100);
-    if (result < 0) {
-        updateLastError(result);
-        return {};
-    }
+            // The first page tells us how many more there are. Queue them all at once.
+            if (packet[0] > 8) {
+                auto pages = ((packet[0] + 7) & ~7) >> 3;
+                for (auto page = 1; page < pages; ++page) {
+                    submitIn(&packet[page * 8], 8, checkPage);
+                }
+            }
+        };
 
-    assert(buffer[0] <= 40);
+        submitOut(request, sizeof(request));
+        submitIn(packet.data(), 8, onFirstPage);
 
-    if (buffer[0] > 8) {
-        auto pages = ((buffer[0] + 7) & ~7) >> 3;
-        for (auto page = 1; page < pages; ++page) {
-            result = libusb_interrupt_transfer(
-                handle, ConfigEndpoint | LIBUSB_ENDPOINT_IN, &buffer[page * 8], 8, &read, 100
-            );
-            if (result < 0) {
-                updateLastError(result);
-                return {};
-            }
+        auto result = wait(timeout);
+        if (result < 0) {
+            return result;
+        }
+        if (pageError < 0) {
+            return pageError;
+        }
+        if (!ConfigPacketView::validate(packet.data(), packet.size())) {
+            // Not a config packet. Most likely a page went missing.
+            return static_cast<int>(LIBUSB_ERROR_IO);
         }
-    }
 
-    auto *packet = reinterpret_cast<ConfigPacket *>(buffer);
-    return parseConfig(*packet);
+        return 0;
+    });
+}
+
+/**
+ * The number of transfers needed to send a block of data after its request.
+ */
+uint32_t writeTransferCount(uint8_t size) {
+    return 1 + (((size + 7) & ~7) >> 3);
 }
 
 bool IkkegolPedal::save() {
+    if (!probe()) {
+        return false;
+    }
+
+    lastSaveStats = {};
+
     bool anyModified = false;
     for (auto modified: pedalModified) {
         anyModified = anyModified || modified;
@@ -307,134 +594,315 @@ bool IkkegolPedal::save() {
         return true;
     }
 
-    USBInterfaceLock interfaceLock(handle, ConfigInterface);
-
-    if (!beginWrite()) {
-        return false;
+    bool anyTriggerModified = false;
+    for (auto modified: pedalTriggerTypeModified) {
+        anyTriggerModified = anyTriggerModified || modified;
     }
 
-    for (auto pedal = 0; pedal < capabilities.pedals; ++pedal) {
+    // Only write what differs from the device. Setting a pedal to what it already has changes nothing.
+    PedalWrites writes;
+    for (uint32_t pedal = 0; pedal < capabilities.pedals; ++pedal) {
         if (!pedalModified[pedal]) {
             continue;
         }
 
-        if (!writeConfiguration(pedal + capabilities.firstPedalIndex, pedalConfiguration[pedal])) {
-            return false;
+        auto packet = encodeConfigPacket(*pedalConfiguration[pedal]);
+        auto &devicePacket = devicePackets[pedal];
+        if (devicePacket && samePacket(*devicePacket, packet)) {
+            ++lastSaveStats.pedalsSkipped;
+            lastSaveStats.transfersSaved += writeTransferCount(packet[0]);
+            continue;
         }
-    }
 
-    bool anyTriggerModified = false;
-    for (auto modified: pedalTriggerTypeModified) {
-        anyTriggerModified = anyTriggerModified || modified;
+        writes.emplace_back(pedal, packet);
     }
 
+    std::optional<TriggerModeBlock> triggerModes;
     if (anyTriggerModified) {
-        if (!writePedalTriggerModes()) {
-            return false;
+        triggerModes = encodePedalTriggerModes();
+        if (deviceTriggerModes && sameTriggerModes(*triggerModes, *deviceTriggerModes)) {
+            lastSaveStats.transfersSaved += writeTransferCount((*triggerModes)[0]);
+            triggerModes.reset();
+        }
+    }
+
+    if (writes.empty() && !triggerModes) {
+        // Nothing to write, so the write never needs to be started
+        ++lastSaveStats.transfersSaved;
+
+        std::fill(pedalModified.begin(), pedalModified.end(), false);
+        std::fill(pedalTriggerTypeModified.begin(), pedalTriggerTypeModified.end(), false);
+        return true;
+    }
+
+    IkkegolSession session(*this);
+    if (!session.isClaimed()) {
+        return false;
+    }
+
+    auto transfersBefore = transferCount;
+
+    auto written = writeBlocks("write configuration", writes, triggerModes);
+    if (verifyWrites) {
+        // A failed write is checked too. Reading back is how to tell which parts of it arrived.
+        auto verifyTransfersBefore = transferCount;
+        written = verifyBlocks(writes, triggerModes);
+        lastSaveStats.verifyTransfers = transferCount - verifyTransfersBefore;
+    }
+
+    if (!written) {
+        // Some of it may have been written. The device can no longer be assumed to hold what was last read.
+        for (auto &[pedal, packet]: writes) {
+            devicePackets[pedal].reset();
         }
+        deviceTriggerModes.reset();
+        return false;
+    }
+
+    for (auto &[pedal, packet]: writes) {
+        devicePackets[pedal] = packet;
     }
+    if (triggerModes) {
+        deviceTriggerModes = triggerModes;
+    }
+
+    lastSaveStats.pedalsWritten = static_cast<uint32_t>(writes.size());
+    lastSaveStats.triggerModesWritten = triggerModes.has_value();
 
     std::fill(pedalModified.begin(), pedalModified.end(), false);
     std::fill(pedalTriggerTypeModified.begin(), pedalTriggerTypeModified.end(), false);
-    readPedalTriggerModes();
+
+    lastSaveStats.transfers = transferCount - transfersBefore;
     return true;
 }
 
-bool IkkegolPedal::beginWrite() {
-    uint8_t request[8] = { 0x01, 0x80, 0x08, 0x01, 0x00, 0x00, 0x00, 0x00 };
-
-    int wrote;
-    auto result = libusb_interrupt_transfer(
-        handle, ConfigEndpoint | LIBUSB_ENDPOINT_OUT, request, sizeof(request), &wrote, 100
-    );
-    if (wrote < 0 || result < 0) {
-        updateLastError(result);
+bool IkkegolPedal::stagePedal(uint32_t pedal, const Configuration &config) {
+    if (!probe()) {
         return false;
     }
 
+    assert(pedal < pedalConfiguration.size());
+
+    // The trigger modes of every pedal are written together, so the others have to be known to keep them as they
+    // are. Nothing else needs to be read.
+    if (!deviceTriggerModes) {
+        IkkegolSession session(*this);
+        if (!session.isClaimed()) {
+            return false;
+        }
+
+        TriggerModeBlock block;
+        if (!readTriggerModeBlock(block)) {
+            return false;
+        }
+        deviceTriggerModes = block;
+    }
+
+    pedalConfiguration[pedal] = config;
+    pedalModified[pedal] = true;
+    // save() leaves the trigger modes alone if they match the device
+    pedalTriggerTypeModified[pedal] = true;
     return true;
 }
 
-bool IkkegolPedal::writeConfiguration(uint32_t pedal, const SharedConfiguration &config) {
-    assert(config);
+bool IkkegolPedal::savePedal(uint32_t pedal, const Configuration &config) {
+    if (!probe()) {
+        return false;
+    }
 
-    auto packet = encodeConfigPacket(config);
+    IkkegolSession session(*this);
+    if (!session.isClaimed()) {
+        return false;
+    }
 
-    uint8_t requestInitiate[8] = { 0x01, 0x81, packet.size, static_cast<uint8_t>(pedal + 1), 0x00, 0x00, 0x00, 0x00 };
+    auto transfersBefore = transferCount;
 
-    int wrote;
-    auto result = libusb_interrupt_transfer(
-        handle, ConfigEndpoint | LIBUSB_ENDPOINT_OUT, requestInitiate, sizeof(requestInitiate), &wrote, 100
-    );
-    if (wrote < 0 || result < 0) {
-        updateLastError(result);
+    if (!stagePedal(pedal, config)) {
         return false;
     }
 
-    auto *requestBody = reinterpret_cast<uint8_t *>(&packet);
+    auto saved = save();
+    // Include the read above
+    lastSaveStats.transfers = transferCount - transfersBefore;
+    return saved;
+}
+
+bool IkkegolPedal::writeBlocks(
+    std::string_view step, const PedalWrites &writes, const std::optional<TriggerModeBlock> &triggerModes
+) {
+    // Writes have no responses so the entire update can be queued up front and sent back-to-back.
+    // It is not retried. After a partial write the device would take the start of the next one as the rest of it.
+    return runStep(step, false, transferTimeout, [&](std::chrono::milliseconds timeout) {
+        auto result = beginWrite();
 
-    auto pages = ((packet.size + 7) & ~7) >> 3;
-    for (auto page = 0; page < pages; ++page) {
-        result = libusb_interrupt_transfer(
-            handle, ConfigEndpoint | LIBUSB_ENDPOINT_OUT, &requestBody[page * 8], 8, &wrote, 100
-        );
-        if (wrote < 0 || result < 0) {
-            updateLastError(result);
+        for (auto it = writes.begin(); result >= 0 && it != writes.end(); ++it) {
+            result = writeConfiguration(it->first + capabilities.firstPedalIndex, it->second);
+        }
+
+        if (result >= 0 && triggerModes) {
+            result = writePedalTriggerModes(*triggerModes);
+        }
+
+        // Always wait, even on failure, so nothing already queued is left in flight
+        auto waitResult = wait(timeout);
+        return (result < 0) ? result : waitResult;
+    });
+}
+
+bool IkkegolPedal::verifyBlocks(PedalWrites writes, std::optional<TriggerModeBlock> triggerModes) {
+    for (uint32_t rewrites = 0;; ++rewrites) {
+        // Only what was written is read back, and each round only what still differs
+        PedalWrites mismatched;
+        for (auto &write: writes) {
+            ConfigPacket packet;
+            if (!readConfiguration(write.first + capabilities.firstPedalIndex, packet)) {
+                return false;
+            }
+
+            if (samePacket(packet, write.second)) {
+                ++lastSaveStats.pedalsVerified;
+            } else {
+                mismatched.push_back(write);
+            }
+        }
+
+        if (triggerModes) {
+            TriggerModeBlock block;
+            if (!readTriggerModeBlock(block)) {
+                return false;
+            }
+
+            if (sameTriggerModes(block, *triggerModes)) {
+                triggerModes.reset();
+            }
+        }
+
+        writes = std::move(mismatched);
+        if (writes.empty() && !triggerModes) {
+            return true;
+        }
+
+        if (rewrites == MaxVerifyRewrites) {
+            lastError = Errors::VerifyFailed;
             return false;
         }
+
+        lastSaveStats.pedalsRewritten += static_cast<uint32_t>(writes.size());
+        lastSaveStats.triggerModesRewritten = lastSaveStats.triggerModesRewritten || triggerModes.has_value();
+
+        // A failed rewrite shows up in the next read back
+        writeBlocks("rewrite configuration", writes, triggerModes);
     }
+}
 
-    return true;
+int IkkegolPedal::beginWrite() {
+    uint8_t request[8] = { 0x01, 0x80, 0x08, 0x01, 0x00, 0x00, 0x00, 0x00 };
+
+    return submitOut(request, sizeof(request));
 }
 
-bool IkkegolPedal::writePedalTriggerModes() {
-    auto payloadSize = static_cast<uint8_t>(capabilities.pedals + capabilities.firstPedalIndex + 1);
-    uint8_t requestInitiate[8] = {
-        0x01, 0x85, payloadSize, 0x00, 0x00, 0x00, 0x00, 0x00
-    };
+int IkkegolPedal::writeConfiguration(uint32_t pedal, const ConfigPacket &packet) {
+    auto size = packet[0];
+    uint8_t requestInitiate[8] = { 0x01, 0x81, size, static_cast<uint8_t>(pedal + 1), 0x00, 0x00, 0x00, 0x00 };
 
-    int wrote;
-    auto result = libusb_interrupt_transfer(
-        handle, ConfigEndpoint | LIBUSB_ENDPOINT_OUT, requestInitiate, sizeof(requestInitiate), &wrote, 100
-    );
-    if (wrote < 0 || result < 0) {
-        updateLastError(result);
-        return false;
+    auto result = submitOut(requestInitiate, sizeof(requestInitiate));
+    if (result < 0) {
+        return result;
+    }
+
+    auto pages = ((size + 7) & ~7) >> 3;
+    for (auto page = 0; page < pages; ++page) {
+        result = submitOut(&packet[page * 8], 8);
+        if (result < 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+TriggerModeBlock IkkegolPedal::encodePedalTriggerModes() const {
+    // Slots this handle knows nothing about keep whatever the device has
+    TriggerModeBlock block {};
+    if (deviceTriggerModes) {
+        block = *deviceTriggerModes;
     }
 
-    uint8_t buffer[16] {};
-    buffer[0] = payloadSize;
+    block[0] = static_cast<uint8_t>(capabilities.pedals + capabilities.firstPedalIndex + 1);
 
-    for (auto pedal = 0; pedal < capabilities.pedals; ++pedal) {
+    for (uint32_t pedal = 0; pedal < capabilities.pedals; ++pedal) {
+        auto &mode = block[1 + pedal + capabilities.firstPedalIndex];
         auto &config = pedalConfiguration[pedal];
         if (config) {
             if (config->trigger == Trigger::OnPress) {
-                buffer[1 + pedal + capabilities.firstPedalIndex] = TM_PRESS;
+                mode = TM_PRESS;
             } else if (config->trigger == Trigger::OnRelease) {
-                buffer[1 + pedal + capabilities.firstPedalIndex] = TM_RELEASE;
+                mode = TM_RELEASE;
             } else {
-                buffer[1 + pedal + capabilities.firstPedalIndex] = TM_PRESS;
+                mode = TM_PRESS;
             }
-        } else {
-            buffer[1 + pedal + capabilities.firstPedalIndex] = TM_PRESS;
+        } else if (!deviceTriggerModes) {
+            mode = TM_PRESS;
         }
     }
 
+    return block;
+}
+
+int IkkegolPedal::writePedalTriggerModes(const TriggerModeBlock &block) {
+    auto payloadSize = block[0];
+    uint8_t requestInitiate[8] = {
+        0x01, 0x85, payloadSize, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+
+    auto result = submitOut(requestInitiate, sizeof(requestInitiate));
+    if (result < 0) {
+        return result;
+    }
+
     auto pages = ((payloadSize + 7) & ~7) >> 3;
     for (auto page = 0; page < pages; ++page) {
-        result = libusb_interrupt_transfer(
-            handle, ConfigEndpoint | LIBUSB_ENDPOINT_OUT, &buffer[page * 8], 8, &wrote, 100
-        );
-        if (wrote < 0 || result < 0) {
-            updateLastError(result);
-            return false;
+        result = submitOut(&block[page * 8], 8);
+        if (result < 0) {
+            return result;
         }
     }
 
-    return true;
+    return 0;
+}
+
+int IkkegolPedal::submitOut(const uint8_t *data, int length, IkkegolTransport::Callback callback) {
+    ++transferCount;
+    return transport->submitOut(data, length, callback);
+}
+
+int IkkegolPedal::submitIn(uint8_t *buffer, int length, IkkegolTransport::Callback callback) {
+    ++transferCount;
+    return transport->submitIn(buffer, length, callback);
+}
+
+int IkkegolPedal::wait(std::chrono::milliseconds idleTimeout) {
+    lastCompletion = std::chrono::steady_clock::now();
+    return transport->wait(idleTimeout);
+}
+
+const std::string &IkkegolPedal::getModel() {
+    probe();
+    return model;
+}
+
+const std::string &IkkegolPedal::getVersion() {
+    probe();
+    return version;
+}
+
+uint32_t IkkegolPedal::getPedalCount() {
+    probe();
+    return capabilities.pedals;
 }
 
-std::string_view IkkegolPedal::getPedalName(uint32_t pedal) const {
+std::string_view IkkegolPedal::getPedalName(uint32_t pedal) {
+    probe();
     assert(pedal < capabilities.pedals);
 
     if (capabilities.pedalNames == nullptr) {
@@ -1,62 +1,218 @@
 #pragma once
 
-#include "../configuration/base.hpp"
+#include "../configuration/configuration.hpp"
 #include "ikkegol_capabilities.hpp"
+#include "ikkegol_protocol.hpp"
+#include "ikkegol_transport.hpp"
+#include "ikkegol_session.hpp"
+#include "../utils/retry_policy.hpp"
+#include <array>
 #include <vector>
 #include <string>
 #include <memory>
-#include <vector>
-#include <libusb.h>
+#include <optional>
+#include <chrono>
+
+/**
+ * How often the config interface was claimed and released, and the time it took. Each claim may detach the kernel
+ * driver and each release re-attach it.
+ */
+struct InterfaceClaimStats {
+    uint32_t claims { 0 };
+    std::chrono::microseconds elapsed { 0 };
+};
+
+/**
+ * What the last call to IkkegolPedal::save() did.
+ */
+struct SaveStats {
+    uint32_t pedalsWritten { 0 };
+    // Pedals which were set to exactly what the device already had
+    uint32_t pedalsSkipped { 0 };
+    bool triggerModesWritten { false };
+    // Transfers made, and transfers avoided by skipping unchanged data
+    uint32_t transfers { 0 };
+    uint32_t transfersSaved { 0 };
+    // Only filled in when writes are verified. The transfers spent verifying are included in transfers.
+    uint32_t pedalsVerified { 0 };
+    uint32_t pedalsRewritten { 0 };
+    bool triggerModesRewritten { false };
+    uint32_t verifyTransfers { 0 };
+};
 
+/**
+ * A handle to a single pedal device.
+ * Constructing one does not communicate with the device. It is opened and identified on first use, or by calling
+ * probe(). The results are cached for the lifetime of the handle.
+ */
 class IkkegolPedal {
 public:
-    explicit IkkegolPedal(libusb_device *, int id);
+    explicit IkkegolPedal(std::unique_ptr<IkkegolTransport>, int id);
     ~IkkegolPedal();
 
-    bool isValid() const { return handle != nullptr; }
+    /**
+     * Opens the device and reads its model and version if not already done.
+     * @returns true if the device could be opened
+     */
+    bool probe();
+
+    bool isValid() { return probe(); }
 
-    const std::string &getModel() const { return model; }
+    const std::string &getModel();
 
-    const std::string &getVersion() const { return version; }
+    const std::string &getVersion();
 
     const std::string &getLastError() const { return lastError; }
 
+    /**
+     * The time taken by the model / version handshake, if it was performed by this handle.
+     */
+    std::optional<std::chrono::microseconds> getHandshakeLatency() const { return handshakeLatency; }
+
     int getId() const { return id; }
 
-    std::string_view getPedalName(uint32_t pedal) const;
+    std::string getPortPath() const { return transport->getPortPath(); }
+
+    /**
+     * Receives every decision the retry policy makes about a failed step.
+     */
+    void setRetryReporter(RetryPolicy::Reporter reporter) { retryPolicy.setReporter(std::move(reporter)); }
+
+    const InterfaceClaimStats &getInterfaceClaimStats() const { return claimStats; }
+
+    std::string_view getPedalName(uint32_t pedal);
+
+    // A pedal mask covering every pedal
+    static constexpr uint32_t AllPedals = ~0u;
+
+    /**
+     * Reads the configuration of the pedals in the mask (bit N for pedal N), and optionally the trigger modes.
+     * Other pedals keep whatever this handle already had for them.
+     */
+    bool load(uint32_t pedalMask, bool triggerModes = true);
+
+    bool load() { return load(AllPedals); }
 
-    bool load();
+    bool loadPedal(uint32_t pedal, bool triggerModes = true) { return load(1u << pedal, triggerModes); }
+
+    /**
+     * Writes the pedals changed by setConfiguration(). Pedals which encode to the same bytes as load() read, and
+     * trigger modes which match the device, are not written.
+     */
     bool save();
 
-    uint32_t getPedalCount() const { return capabilities.pedals; }
+    /**
+     * Sets and writes a single pedal without loading the others. The pedal is written as given, and the trigger mode
+     * block is only read if it is not already known. It is only written if the pedal's trigger changes.
+     */
+    bool savePedal(uint32_t pedal, const Configuration &config);
+
+    /**
+     * Sets a single pedal without loading the others, to be written by the next save(). Like savePedal(), the trigger
+     * mode block is only read if it is not already known. Setting several pedals this way writes them all at once.
+     */
+    bool stagePedal(uint32_t pedal, const Configuration &config);
+
+    const SaveStats &getLastSaveStats() const { return lastSaveStats; }
 
-    const SharedConfiguration getConfiguration(uint32_t pedal) const;
-    void setConfiguration(uint32_t pedal, const SharedConfiguration &config);
+    /**
+     * When enabled, save() reads back the pedals and trigger modes it wrote and rewrites any that differ. Nothing it
+     * skipped is read, so the cost follows the size of the change.
+     */
+    void setVerifyWrites(bool verify) { verifyWrites = verify; }
+
+    uint32_t getPedalCount();
+
+    const PedalConfiguration &getConfiguration(uint32_t pedal) const;
+    void setConfiguration(uint32_t pedal, const Configuration &config);
 private:
-    libusb_device_handle *handle {};
+    friend class IkkegolSession;
+
+    std::unique_ptr<IkkegolTransport> transport;
+    bool opened { false };
+    bool openAttempted { false };
+    bool probed { false };
     std::string model;
     std::string version;
+    std::optional<std::chrono::microseconds> handshakeLatency;
     int id;
     Capabilities capabilities;
-    std::vector<SharedConfiguration> pedalConfiguration;
+    std::vector<PedalConfiguration> pedalConfiguration;
     std::vector<bool> pedalModified;
     std::vector<bool> pedalTriggerTypeModified;
 
+    // Exactly what the device holds, where known. Used to skip writes which would change nothing
+    std::vector<std::optional<ConfigPacket>> devicePackets;
+    std::optional<TriggerModeBlock> deviceTriggerModes;
+    SaveStats lastSaveStats;
+    uint32_t transferCount { 0 };
+    bool verifyWrites { false };
+
+    // Encoded pedals to write, by pedal index
+    typedef std::vector<std::pair<uint32_t, ConfigPacket>> PedalWrites;
+
+    RetryPolicy retryPolicy;
+    // Sized from the polling interval once the device is open
+    std::chrono::milliseconds transferTimeout;
+    std::chrono::milliseconds handshakeTimeout;
+    std::chrono::steady_clock::time_point lastCompletion;
+
+    // The number of sessions currently holding the config interface
+    uint32_t interfaceClaims { 0 };
+    InterfaceClaimStats claimStats;
+
     std::string lastError;
 
+    bool open();
+    void applyEndpointTiming();
+    bool acquireInterface(bool reattachDriver);
+    void releaseInterface();
     void init();
     bool readModelAndVersion();
     bool readPedalTriggerModes();
-    bool beginWrite();
-    SharedConfiguration readConfiguration(uint32_t pedal);
-    bool writeConfiguration(uint32_t pedal, const SharedConfiguration &config);
-    bool writePedalTriggerModes();
+    bool readTriggerModeBlock(TriggerModeBlock &block);
+    bool readConfiguration(uint32_t pedal, ConfigPacket &packet);
+    TriggerModeBlock encodePedalTriggerModes() const;
+    // Queue the write without waiting for it. These return 0 or a LIBUSB_ERROR_* code
+    int beginWrite();
+    int writeConfiguration(uint32_t pedal, const ConfigPacket &packet);
+    int writePedalTriggerModes(const TriggerModeBlock &block);
+    bool writeBlocks(
+        std::string_view step, const PedalWrites &writes, const std::optional<TriggerModeBlock> &triggerModes
+    );
+    bool verifyBlocks(PedalWrites writes, std::optional<TriggerModeBlock> triggerModes);
+
+    /**
+     * Runs a step of the protocol under the retry policy. Each attempt queues its transfers, waits for them with
+     * the timeout it is given and checks the response.
+     * Attempts return 0 on success, otherwise a LIBUSB_ERROR_* code. They are called directly rather than through
+     * a std::function, which would allocate for every step. Only used, and so only defined, in ikkegol_pedal.cpp.
+     */
+    template<typename Attempt>
+    bool runStep(std::string_view step, bool idempotent, std::chrono::milliseconds defaultTimeout, Attempt &&attempt);
+
+    // Transfers go through these so they are counted
+    int submitOut(const uint8_t *data, int length, IkkegolTransport::Callback callback = {});
+    int submitIn(uint8_t *buffer, int length, IkkegolTransport::Callback callback = {});
+    int wait(std::chrono::milliseconds idleTimeout);
 
     void updateLastError(int result);
 };
 
 typedef std::shared_ptr<IkkegolPedal> SharedIkkegolPedal;
 
+/**
+ * Lists all supported devices without opening them.
+ */
 std::vector<SharedIkkegolPedal> discoverIkkegolDevices();
-SharedIkkegolPedal findIkkegolDevice(uint32_t id);
+
+/**
+ * Probes all the given devices concurrently.
+ */
+void probeIkkegolDevices(const std::vector<SharedIkkegolPedal> &devices);
+/**
+ * Finds a single device by either its ID (as listed by discoverIkkegolDevices) or its USB port path (eg. 1-2.3).
+ * Only the matching device is opened.
+ */
+SharedIkkegolPedal findIkkegolDevice(const std::string_view &address);
 
@@ -2,101 +2,149 @@
 #include "ikkegol_protocol.hpp"
 #include "../configuration/keys.hpp"
 #include "../utils/usb_scancodes.hpp"
-#include "../configuration/mouse.hpp"
-#include "../configuration/gamepad.hpp"
-#include "../configuration/media.hpp"
-#include "../configuration/text.hpp"
-#include "../configuration/keyboard.hpp"
-
-#define MODIFIER(name) (packet.keyboard.modifiers & name) != 0
-#define MOUSE_BUTTON(name) (packet.mouse.buttons & name) != 0
-
-SharedConfiguration parseKeyboardConfig(const ConfigPacket &packet);
-SharedConfiguration parseTextConfig(const ConfigPacket &packet);
-SharedConfiguration parseMouseConfig(const ConfigPacket &packet);
-SharedConfiguration parseGamepadConfig(const ConfigPacket &packet);
-SharedConfiguration parseMediaConfig(const ConfigPacket &packet);
-
-SharedConfiguration parseConfig(const ConfigPacket &packet) {
-    SharedConfiguration configuration;
-    switch (packet.type) {
+#include <algorithm>
+
+
+KeyboardConfiguration parseKeyboardConfig(const ConfigPacketView &packet);
+TextConfiguration parseTextConfig(const ConfigPacketView &packet);
+MouseConfiguration parseMouseConfig(const ConfigPacketView &packet);
+std::optional<GamepadConfiguration> parseGamepadConfig(const ConfigPacketView &packet);
+std::optional<MediaConfiguration> parseMediaConfig(const ConfigPacketView &packet);
+
+/**
+ * The smallest size a packet of the type can have, or 0 for types with no data.
+ */
+uint8_t minimumPacketSize(uint8_t type) {
+    switch (type) {
         case CT_KEYBOARD:
         case CT_KEYBOARD_ONCE:
         case CT_KEYBOARD_MULTI:
         case CT_KEYBOARD_MULTI_ONCE:
-            return parseKeyboardConfig(packet);
-        case CT_TEXT:
-            return parseTextConfig(packet);
+            return ConfigPacketLayout::KeyboardKeys;
         case CT_MOUSE:
-            return parseMouseConfig(packet);
+            return ConfigPacketLayout::MouseWheel + 1;
         case CT_MEDIA:
-            return parseMediaConfig(packet);
         case CT_GAME:
-            return parseGamepadConfig(packet);
-        case CT_UNCONFIGURED:
-            return {};
+            return ConfigPacketLayout::ButtonCode + 1;
+        case CT_TEXT:
+            return ConfigPacketLayout::Text;
+        default:
+            return 0;
     }
-
-    return configuration;
 }
 
-SharedConfiguration parseKeyboardConfig(const ConfigPacket &packet) {
-    auto config = std::make_shared<KeyboardConfiguration>();
-    if (packet.type == CT_KEYBOARD_ONCE || packet.type == CT_KEYBOARD_MULTI_ONCE) {
-        config->mode = KeyMode::OneShot;
-    } else {
-        config->mode = KeyMode::Standard;
+std::optional<ConfigPacketView> ConfigPacketView::validate(const uint8_t *data, size_t length) {
+    if (data == nullptr || length <= ConfigPacketLayout::Type) {
+        return {};
     }
 
-    std::vector<std::string> keys;
-    if (MODIFIER(MK_LEFT_CONTROL)) {
-        keys.emplace_back(KeyName::LeftControl);
-    }
-    if (MODIFIER(MK_RIGHT_CONTROL)) {
-        keys.emplace_back(KeyName::RightControl);
-    }
-    if (MODIFIER(MK_LEFT_SHIFT)) {
-        keys.emplace_back(KeyName::LeftShift);
+    auto size = data[ConfigPacketLayout::Size];
+    if (size > ConfigPacketCapacity) {
+        return {};
     }
-    if (MODIFIER(MK_RIGHT_SHIFT)) {
-        keys.emplace_back(KeyName::RightShift);
-    }
-    if (MODIFIER(MK_LEFT_ALT)) {
-        keys.emplace_back(KeyName::LeftAlt);
+
+    auto type = data[ConfigPacketLayout::Type];
+    if (type == CT_UNCONFIGURED) {
+        // Empty slots carry no data, and may not even claim the size and type bytes
+        return ConfigPacketView(data);
     }
-    if (MODIFIER(MK_RIGHT_ALT)) {
-        keys.emplace_back(KeyName::RightAlt);
+
+    if (size > length || size < std::max<size_t>(minimumPacketSize(type), ConfigPacketLayout::Type + 1)) {
+        return {};
     }
-    if (MODIFIER(MK_LEFT_SUPER)) {
-        keys.emplace_back(KeyName::LeftSuper);
+
+    return ConfigPacketView(data);
+}
+
+size_t ConfigPacketView::keyboardKeyCount() const {
+    return std::clamp<int>(
+        size() - static_cast<int>(ConfigPacketLayout::KeyboardKeys), 0, ConfigPacketLayout::KeyboardKeyCount
+    );
+}
+
+size_t ConfigPacketView::textLength() const {
+    return std::clamp<int>(size() - static_cast<int>(ConfigPacketLayout::Text), 0, ConfigPacketLayout::TextLength);
+}
+
+PedalConfiguration parseConfig(const ConfigPacket &packet) {
+    auto view = ConfigPacketView::validate(packet.data(), packet.size());
+    if (!view) {
+        return {};
     }
-    if (MODIFIER(MK_RIGHT_SUPER)) {
-        keys.emplace_back(KeyName::RightSuper);
+
+    return parseConfig(*view);
+}
+
+PedalConfiguration parseConfig(const ConfigPacketView &packet) {
+    Configuration configuration;
+    switch (packet.type()) {
+        case CT_KEYBOARD:
+        case CT_KEYBOARD_ONCE:
+        case CT_KEYBOARD_MULTI:
+        case CT_KEYBOARD_MULTI_ONCE:
+            configuration.value = parseKeyboardConfig(packet);
+            return configuration;
+        case CT_TEXT:
+            configuration.value = parseTextConfig(packet);
+            return configuration;
+        case CT_MOUSE:
+            configuration.value = parseMouseConfig(packet);
+            return configuration;
+        // Codes the device does not define are treated as unconfigured
+        case CT_MEDIA:
+            if (auto media = parseMediaConfig(packet)) {
+                configuration.value = *media;
+                return configuration;
+            }
+            return {};
+        case CT_GAME:
+            if (auto gamepad = parseGamepadConfig(packet)) {
+                configuration.value = *gamepad;
+                return configuration;
+            }
+            return {};
+        case CT_UNCONFIGURED:
+            return {};
     }
 
-    for (auto index = 0; index < packet.size - offsetof(ConfigPacket, keyboard.keys); ++index) {
-        auto key = packet.keyboard.keys[index];
-        if (key == 0) {
-            break;
-        }
+    return {};
+}
 
-        auto name = scanCodeToKey(key);
-        if (name != nullptr) {
-            keys.emplace_back(name);
-        }
+// Keyboard configurations hold the modifier byte exactly as the device does
+static_assert(MK_LEFT_CONTROL == 1 << (KeyCode::LeftControl - KeyCode::FirstModifier));
+static_assert(MK_LEFT_SHIFT == 1 << (KeyCode::LeftShift - KeyCode::FirstModifier));
+static_assert(MK_LEFT_ALT == 1 << (KeyCode::LeftAlt - KeyCode::FirstModifier));
+static_assert(MK_LEFT_SUPER == 1 << (KeyCode::LeftSuper - KeyCode::FirstModifier));
+static_assert(MK_RIGHT_CONTROL == 1 << (KeyCode::RightControl - KeyCode::FirstModifier));
+static_assert(MK_RIGHT_SHIFT == 1 << (KeyCode::RightShift - KeyCode::FirstModifier));
+static_assert(MK_RIGHT_ALT == 1 << (KeyCode::RightAlt - KeyCode::FirstModifier));
+static_assert(MK_RIGHT_SUPER == 1 << (KeyCode::RightSuper - KeyCode::FirstModifier));
+static_assert(ConfigPacketLayout::KeyboardKeyCount == KeyboardConfiguration::MaxKeys);
+
+KeyboardConfiguration parseKeyboardConfig(const ConfigPacketView &packet) {
+    KeyboardConfiguration config;
+    if (packet.type() == CT_KEYBOARD_ONCE || packet.type() == CT_KEYBOARD_MULTI_ONCE) {
+        config.mode = KeyMode::OneShot;
+    } else {
+        config.mode = KeyMode::Standard;
     }
 
-    config->keys = keys;
+    config.modifiers = packet.keyboardModifiers();
+    std::copy_n(packet.keyboardKeys(), packet.keyboardKeyCount(), config.keys.begin());
+
     return config;
 }
 
-SharedConfiguration parseTextConfig(const ConfigPacket &packet) {
-    auto config = std::make_shared<TextConfiguration>();
-    auto length = packet.size - offsetof(ConfigPacket, string.string);
-    std::string text;
+static_assert(ConfigPacketLayout::TextLength == TextConfiguration::MaxLength);
 
-    for (auto index = 0; index < length; ++index) {
-        int scanCode = packet.string.string[index];
+TextConfiguration parseTextConfig(const ConfigPacketView &packet) {
+    TextConfiguration config;
+    auto *codes = packet.text();
+    auto length = packet.textLength();
+    size_t textLength = 0;
+
+    for (size_t index = 0; index < length; ++index) {
+        int scanCode = codes[index];
         if (scanCode == 0) {
             break;
         }
@@ -106,63 +154,52 @@ SharedConfiguration parseTextConfig(const ConfigPacket &packet) {
 
         auto ch = scanCodeToPrintable(scanCode, shift);
         if (ch != '\0') {
-            text.push_back(ch);
+            config.text[textLength++] = ch;
         }
     }
 
-    config->text = text;
     return config;
 }
 
-SharedConfiguration parseMouseConfig(const ConfigPacket &packet) {
-    auto config = std::make_shared<MouseConfiguration>();
+// Mouse button sets use the same bits as the device
+static_assert(MouseButtons { MouseButton::Left }.bits() == MB_LEFT);
+static_assert(MouseButtons { MouseButton::Right }.bits() == MB_RIGHT);
+static_assert(MouseButtons { MouseButton::Middle }.bits() == MB_MIDDLE);
+static_assert(MouseButtons { MouseButton::Back }.bits() == MB_BACK);
+static_assert(MouseButtons { MouseButton::Forward }.bits() == MB_FORWARD);
 
-    std::unordered_set<MouseButton> buttons;
-    if (MOUSE_BUTTON(MB_LEFT)) {
-        buttons.insert(MouseButton::Left);
-    }
-    if (MOUSE_BUTTON(MB_RIGHT)) {
-        buttons.insert(MouseButton::Right);
-    }
-    if (MOUSE_BUTTON(MB_MIDDLE)) {
-        buttons.insert(MouseButton::Middle);
-    }
-    if (MOUSE_BUTTON(MB_BACK)) {
-        buttons.insert(MouseButton::Back);
-    }
-    if (MOUSE_BUTTON(MB_FORWARD)) {
-        buttons.insert(MouseButton::Forward);
-    }
+MouseConfiguration parseMouseConfig(const ConfigPacketView &packet) {
+    MouseConfiguration config;
 
-    if (!buttons.empty()) {
-        config->mode = MouseMode::Buttons;
-        config->buttons = buttons;
+    config.buttons = MouseButtons::fromBits(packet.mouseButtons());
+    if (!config.buttons.empty()) {
+        config.mode = MouseMode::Buttons;
     } else {
-        config->mode = MouseMode::Axis;
-        config->relativeX = packet.mouse.mouseX;
-        config->relativeY = packet.mouse.mouseY;
-        config->wheelDelta = packet.mouse.mouseWheel;
+        config.mode = MouseMode::Axis;
+        config.relativeX = packet.mouseX();
+        config.relativeY = packet.mouseY();
+        config.wheelDelta = packet.mouseWheel();
     }
 
     return config;
 }
 
-SharedConfiguration parseGamepadConfig(const ConfigPacket &packet) {
-    auto config = std::make_shared<GamepadConfiguration>();
-
-    auto button = static_cast<GamepadButton>(packet.game.key - 1);
-    config->button = button;
+std::optional<GamepadConfiguration> parseGamepadConfig(const ConfigPacketView &packet) {
+    auto button = GamepadButtonTable.fromCode(packet.buttonCode());
+    if (!button) {
+        return {};
+    }
 
-    return config;
+    return GamepadConfiguration { *button };
 }
 
-SharedConfiguration parseMediaConfig(const ConfigPacket &packet) {
-    auto config = std::make_shared<MediaConfiguration>();
-
-    auto button = static_cast<MultiMediaButton>(packet.media.key - 1);
-    config->button = button;
+std::optional<MediaConfiguration> parseMediaConfig(const ConfigPacketView &packet) {
+    auto button = MediaButtonTable.fromCode(packet.buttonCode());
+    if (!button) {
+        return {};
+    }
 
-    return config;
+    return MediaConfiguration { *button };
 }
 
 ConfigPacket encodeKeyboardPacket(const KeyboardConfiguration &config);
@@ -171,249 +208,123 @@ ConfigPacket encodeTextPacket(const TextConfiguration &config);
 ConfigPacket encodeMediaPacket(const MediaConfiguration &config);
 ConfigPacket encodeGamepadPacket(const GamepadConfiguration &config);
 
-ConfigPacket encodeConfigPacket(const SharedConfiguration &config) {
-    switch (config->type()) {
+bool samePacket(const ConfigPacket &a, const ConfigPacket &b) {
+    if (a[0] != b[0]) {
+        return false;
+    }
+
+    return std::equal(a.begin(), a.begin() + std::min<size_t>(a[0], a.size()), b.begin());
+}
+
+bool sameTriggerModes(const TriggerModeBlock &a, const TriggerModeBlock &b) {
+    if (a[0] != b[0]) {
+        return false;
+    }
+
+    return std::equal(a.begin(), a.begin() + std::min<size_t>(a[0], a.size()), b.begin());
+}
+
+ConfigPacket encodeConfigPacket(const Configuration &config) {
+    switch (config.type()) {
         case ConfigurationType::Keyboard:
-            return encodeKeyboardPacket(static_cast<KeyboardConfiguration &>(*config));
+            return encodeKeyboardPacket(std::get<KeyboardConfiguration>(config.value));
         case ConfigurationType::Mouse:
-            return encodeMousePacket(static_cast<MouseConfiguration &>(*config));
+            return encodeMousePacket(std::get<MouseConfiguration>(config.value));
         case ConfigurationType::Text:
-            return encodeTextPacket(static_cast<TextConfiguration &>(*config));
+            return encodeTextPacket(std::get<TextConfiguration>(config.value));
         case ConfigurationType::Media:
-            return encodeMediaPacket(static_cast<MediaConfiguration &>(*config));
+            return encodeMediaPacket(std::get<MediaConfiguration>(config.value));
         case ConfigurationType::Gamepad:
-            return encodeGamepadPacket(static_cast<GamepadConfiguration &>(*config));
+            return encodeGamepadPacket(std::get<GamepadConfiguration>(config.value));
     }
+
+    return {};
 }
 
 ConfigPacket encodeKeyboardPacket(const KeyboardConfiguration &config) {
     ConfigPacket packet {};
-    assert(!config.keys.empty());
-
-    packet.keyboard.modifiers = 0;
-    std::fill_n(packet.keyboard.keys, sizeof(packet.keyboard.keys), 0);
-    auto index = 0;
-
-    for (auto &key: config.keys) {
-        if (key == KeyName::LeftControl) {
-            packet.keyboard.modifiers |= MK_LEFT_CONTROL;
-        } else if (key == KeyName::LeftShift) {
-            packet.keyboard.modifiers |= MK_LEFT_SHIFT;
-        } else if (key == KeyName::LeftAlt) {
-            packet.keyboard.modifiers |= MK_LEFT_ALT;
-        } else if (key == KeyName::LeftSuper) {
-            packet.keyboard.modifiers |= MK_LEFT_SUPER;
-        } else if (key == KeyName::RightControl) {
-            packet.keyboard.modifiers |= MK_RIGHT_CONTROL;
-        } else if (key == KeyName::RightShift) {
-            packet.keyboard.modifiers |= MK_RIGHT_SHIFT;
-        } else if (key == KeyName::RightAlt) {
-            packet.keyboard.modifiers |= MK_RIGHT_ALT;
-        } else if (key == KeyName::RightSuper) {
-            packet.keyboard.modifiers |= MK_RIGHT_SUPER;
-        } else {
-            auto scanCode = scanCodeFromKey(key);
-            assert(scanCode >= 0);
-            assert(index < 6);
-            packet.keyboard.keys[index++] = static_cast<int8_t>(scanCode);
-        }
-    }
+    auto keyCount = config.keyCount();
+    assert(keyCount > 0 || config.modifiers != 0);
+
+    packet[ConfigPacketLayout::KeyboardModifiers] = config.modifiers;
+    std::copy(config.keys.begin(), config.keys.end(), &packet[ConfigPacketLayout::KeyboardKeys]);
 
     if (config.mode == KeyMode::Standard) {
-        if (index > 1) {
-            packet.type = CT_KEYBOARD_MULTI;
+        if (keyCount > 1) {
+            packet[ConfigPacketLayout::Type] = CT_KEYBOARD_MULTI;
         } else {
-            packet.type = CT_KEYBOARD;
+            packet[ConfigPacketLayout::Type] = CT_KEYBOARD;
         }
     } else {
-        if (index > 1) {
-            packet.type = CT_KEYBOARD_MULTI_ONCE;
+        if (keyCount > 1) {
+            packet[ConfigPacketLayout::Type] = CT_KEYBOARD_MULTI_ONCE;
         } else {
-            packet.type = CT_KEYBOARD_ONCE;
+            packet[ConfigPacketLayout::Type] = CT_KEYBOARD_ONCE;
         }
     }
 
-    if (index == 1) {
+    if (keyCount == 1) {
         // This is an interesting quirk of these devices.
-        packet.size = 8;
+        packet[ConfigPacketLayout::Size] = 8;
     } else {
-        packet.size = 3 + index;
+        packet[ConfigPacketLayout::Size] = static_cast<uint8_t>(ConfigPacketLayout::KeyboardKeys + keyCount);
     }
 
     return packet;
 }
 
 ConfigPacket encodeMousePacket(const MouseConfiguration &config) {
-    ConfigPacket packet {
-        .size = 8,
-        .type = CT_MOUSE,
-    };
+    ConfigPacket packet {};
+    packet[ConfigPacketLayout::Size] = 8;
+    packet[ConfigPacketLayout::Type] = CT_MOUSE;
 
     if (config.mode == MouseMode::Buttons) {
-        packet.mouse.buttons = 0;
-        for (auto button: config.buttons) {
-            switch (button) {
-                case MouseButton::Left:
-                    packet.mouse.buttons |= MB_LEFT;
-                    break;
-                case MouseButton::Right:
-                    packet.mouse.buttons |= MB_RIGHT;
-                    break;
-                case MouseButton::Middle:
-                    packet.mouse.buttons |= MB_MIDDLE;
-                    break;
-                case MouseButton::Back:
-                    packet.mouse.buttons |= MB_BACK;
-                    break;
-                case MouseButton::Forward:
-                    packet.mouse.buttons |= MB_FORWARD;
-                    break;
-            };
-        }
+        packet[ConfigPacketLayout::MouseButtons] = config.buttons.bits();
     } else {
-        packet.mouse.mouseX = config.relativeX;
-        packet.mouse.mouseY = config.relativeY;
-        packet.mouse.mouseWheel = config.wheelDelta;
+        packet[ConfigPacketLayout::MouseX] = static_cast<uint8_t>(config.relativeX);
+        packet[ConfigPacketLayout::MouseY] = static_cast<uint8_t>(config.relativeY);
+        packet[ConfigPacketLayout::MouseWheel] = static_cast<uint8_t>(config.wheelDelta);
     }
 
     return packet;
 }
 
 ConfigPacket encodeTextPacket(const TextConfiguration &config) {
-    ConfigPacket packet {
-        .type = CT_TEXT,
-    };
+    ConfigPacket packet {};
+    packet[ConfigPacketLayout::Type] = CT_TEXT;
 
-    auto count = 0;
-    for (auto index = 0; index < config.text.size() && index < 38; ++index) {
-        auto code = scanCodeFromPrintable(config.text[index]);
+    auto text = config.getText();
+    size_t count = 0;
+    for (size_t index = 0; index < text.size() && index < ConfigPacketLayout::TextLength; ++index) {
+        auto code = scanCodeFromPrintable(text[index]);
         if (code < 0) {
             // Replacement code
             code = PrintableCharsToScancodes[' '];
         }
 
-        packet.string.string[index] = static_cast<char>(code);
+        packet[ConfigPacketLayout::Text + index] = static_cast<uint8_t>(code);
         ++count;
     }
 
-    packet.size = 2 + count;
+    packet[ConfigPacketLayout::Size] = static_cast<uint8_t>(ConfigPacketLayout::Text + count);
 
     return packet;
 }
 
 ConfigPacket encodeMediaPacket(const MediaConfiguration &config) {
-    ConfigPacket packet {
-        .size = 8,
-        .type = CT_MEDIA,
-    };
-
-    switch (config.button) {
-        case MultiMediaButton::DecreaseVolume:
-            packet.media.key = MEB_VOLUME_MINUS;
-            break;
-        case MultiMediaButton::IncreaseVolume:
-            packet.media.key = MEB_VOLUME_PLUS;
-            break;
-        case MultiMediaButton::Mute:
-            packet.media.key = MEB_MUTE;
-            break;
-        case MultiMediaButton::Play:
-            packet.media.key = MEB_PLAY;
-            break;
-        case MultiMediaButton::Forward:
-            packet.media.key = MEB_FORWARD;
-            break;
-        case MultiMediaButton::Next:
-            packet.media.key = MEB_NEXT;
-            break;
-        case MultiMediaButton::Stop:
-            packet.media.key = MEB_STOP;
-            break;
-        case MultiMediaButton::OpenPlayer:
-            packet.media.key = MEB_OPEN_PLAYER;
-            break;
-        case MultiMediaButton::OpenHomepage:
-            packet.media.key = MEB_OPEN_HOMEPAGE;
-            break;
-        case MultiMediaButton::StopWebPage:
-            packet.media.key = MEB_STOP_WEBPAGE;
-            break;
-        case MultiMediaButton::NavigateBack:
-            packet.media.key = MEB_BACK_BROWSE;
-            break;
-        case MultiMediaButton::NavigateForward:
-            packet.media.key = MEB_FORWARD_BROWSE;
-            break;
-        case MultiMediaButton::Refresh:
-            packet.media.key = MEB_REFRESH;
-            break;
-        case MultiMediaButton::OpenMyComputer:
-            packet.media.key = MEB_OPEN_MY_COMPUTER;
-            break;
-        case MultiMediaButton::OpenMail:
-            packet.media.key = MEB_OPEN_MAIL;
-            break;
-        case MultiMediaButton::OpenCalc:
-            packet.media.key = MEB_OPEN_CALC;
-            break;
-        case MultiMediaButton::OpenSearch:
-            packet.media.key = MEB_OPEN_SEARCH;
-            break;
-        case MultiMediaButton::Shutdown:
-            packet.media.key = MEB_SHUTDOWN;
-            break;
-        case MultiMediaButton::Sleep:
-            packet.media.key = MEB_SLEEP;
-            break;
-    }
+    ConfigPacket packet {};
+    packet[ConfigPacketLayout::Size] = 8;
+    packet[ConfigPacketLayout::Type] = CT_MEDIA;
+    packet[ConfigPacketLayout::ButtonCode] = MediaButtonTable.toCode(config.button);
 
     return packet;
 }
 
 ConfigPacket encodeGamepadPacket(const GamepadConfiguration &config) {
-    ConfigPacket packet {
-        .size = 8,
-        .type = CT_GAME,
-    };
-
-    switch (config.button) {
-        case GamepadButton::Left:
-            packet.game.key = GK_LEFT;
-            break;
-        case GamepadButton::Right:
-            packet.game.key = GK_RIGHT;
-            break;
-        case GamepadButton::Up:
-            packet.game.key = GK_UP;
-            break;
-        case GamepadButton::Down:
-            packet.game.key = GK_DOWN;
-            break;
-        case GamepadButton::Button1:
-            packet.game.key = GK_BUTTON_1;
-            break;
-        case GamepadButton::Button2:
-            packet.game.key = GK_BUTTON_2;
-            break;
-        case GamepadButton::Button3:
-            packet.game.key = GK_BUTTON_3;
-            break;
-        case GamepadButton::Button4:
-            packet.game.key = GK_BUTTON_4;
-            break;
-        case GamepadButton::Button5:
-            packet.game.key = GK_BUTTON_5;
-            break;
-        case GamepadButton::Button6:
-            packet.game.key = GK_BUTTON_6;
-            break;
-        case GamepadButton::Button7:
-            packet.game.key = GK_BUTTON_7;
-            break;
-        case GamepadButton::Button8:
-            packet.game.key = GK_BUTTON_8;
-            break;
-    }
+    ConfigPacket packet {};
+    packet[ConfigPacketLayout::Size] = 8;
+    packet[ConfigPacketLayout::Type] = CT_GAME;
+    packet[ConfigPacketLayout::ButtonCode] = GamepadButtonTable.toCode(config.button);
 
     return packet;
 }
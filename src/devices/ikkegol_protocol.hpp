@@ -1,8 +1,10 @@
 #pragma once
 
-#include "../configuration/base.hpp"
-
-#define PACKED __attribute__ ((packed))
+#include "../configuration/configuration.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
 
 enum ModifierKeys : unsigned char {
     MK_LEFT_CONTROL = 0x01,
@@ -23,43 +25,6 @@ enum ProtocolMouseButton : unsigned char {
     MB_FORWARD = 0x10,
 };
 
-enum MediaButton : unsigned char {
-    MEB_VOLUME_MINUS = 1,
-    MEB_VOLUME_PLUS,
-    MEB_MUTE,
-    MEB_PLAY,
-    MEB_FORWARD,
-    MEB_NEXT,
-    MEB_STOP,
-    MEB_OPEN_PLAYER,
-    MEB_OPEN_HOMEPAGE,
-    MEB_STOP_WEBPAGE,
-    MEB_BACK_BROWSE,
-    MEB_FORWARD_BROWSE,
-    MEB_REFRESH,
-    MEB_OPEN_MY_COMPUTER,
-    MEB_OPEN_MAIL,
-    MEB_OPEN_CALC,
-    MEB_OPEN_SEARCH,
-    MEB_SHUTDOWN,
-    MEB_SLEEP,
-};
-
-enum GameKey : unsigned char {
-    GK_LEFT = 1,
-    GK_RIGHT,
-    GK_UP,
-    GK_DOWN,
-    GK_BUTTON_1,
-    GK_BUTTON_2,
-    GK_BUTTON_3,
-    GK_BUTTON_4,
-    GK_BUTTON_5,
-    GK_BUTTON_6,
-    GK_BUTTON_7,
-    GK_BUTTON_8,
-};
-
 enum TriggerMode : unsigned char {
     TM_RELEASE,
     TM_PRESS
@@ -77,34 +42,95 @@ enum ConfigType : unsigned char {
     CT_GAME = 0x08,
 };
 
-struct PACKED ConfigPacket {
-    uint8_t size;
-    ConfigType type;
-
-    union {
-        struct PACKED {
-            uint8_t modifiers;
-            uint8_t keys[6];
-        } keyboard;
-        struct PACKED {
-            char unknown[2];
-            char buttons;
-            char mouseX;
-            char mouseY;
-            char mouseWheel;
-        } mouse;
-        struct PACKED {
-            MediaButton key;
-        } media;
-        struct PACKED {
-            GameKey key;
-        } game;
-        struct PACKED {
-            char string[38];
-        } string;
-        char padding[38];
-    };
+/**
+ * The largest config packet (0x81 / 0x82): a size byte and a ConfigType, followed by up to 38 bytes of data.
+ */
+constexpr size_t ConfigPacketCapacity = 40;
+
+/**
+ * A config packet as held by the device. Read one through a ConfigPacketView.
+ */
+typedef std::array<uint8_t, ConfigPacketCapacity> ConfigPacket;
+
+/**
+ * Where each field sits within a config packet.
+ */
+namespace ConfigPacketLayout {
+constexpr size_t Size = 0;
+constexpr size_t Type = 1;
+
+constexpr size_t KeyboardModifiers = 2;
+constexpr size_t KeyboardKeys = 3;
+constexpr size_t KeyboardKeyCount = 6;
+
+constexpr size_t MouseButtons = 4;
+constexpr size_t MouseX = 5;
+constexpr size_t MouseY = 6;
+constexpr size_t MouseWheel = 7;
+
+// Media and gamepad codes are listed in MediaButtonTable and GamepadButtonTable
+constexpr size_t ButtonCode = 2;
+
+// One scan code per character, with 0x80 set for shift
+constexpr size_t Text = 2;
+constexpr size_t TextLength = 38;
+}
+
+/**
+ * Typed, read only access to a config packet held in someone else's bytes, such as a transfer buffer. The bytes are
+ * checked once when the view is made, so the accessors never read past the packet.
+ */
+class ConfigPacketView {
+public:
+    /**
+     * Returns nothing if the bytes do not hold a whole packet, or hold too little for the packet's type. Packets of
+     * types this does not know are allowed, and decode as unconfigured. The bytes must outlive the view.
+     */
+    static std::optional<ConfigPacketView> validate(const uint8_t *data, size_t length);
+
+    uint8_t size() const { return data[ConfigPacketLayout::Size]; }
+    ConfigType type() const { return static_cast<ConfigType>(data[ConfigPacketLayout::Type]); }
+
+    uint8_t keyboardModifiers() const { return data[ConfigPacketLayout::KeyboardModifiers]; }
+    const uint8_t *keyboardKeys() const { return &data[ConfigPacketLayout::KeyboardKeys]; }
+    /**
+     * How many of the key bytes are within the packet. Unused keys are 0.
+     */
+    size_t keyboardKeyCount() const;
+
+    uint8_t mouseButtons() const { return data[ConfigPacketLayout::MouseButtons]; }
+    int8_t mouseX() const { return static_cast<int8_t>(data[ConfigPacketLayout::MouseX]); }
+    int8_t mouseY() const { return static_cast<int8_t>(data[ConfigPacketLayout::MouseY]); }
+    int8_t mouseWheel() const { return static_cast<int8_t>(data[ConfigPacketLayout::MouseWheel]); }
+
+    uint8_t buttonCode() const { return data[ConfigPacketLayout::ButtonCode]; }
+
+    const uint8_t *text() const { return &data[ConfigPacketLayout::Text]; }
+    size_t textLength() const;
+private:
+    explicit ConfigPacketView(const uint8_t *data) : data(data) {}
+
+    const uint8_t *data;
 };
 
-SharedConfiguration parseConfig(const ConfigPacket &packet);
-ConfigPacket encodeConfigPacket(const SharedConfiguration &config);
+/**
+ * The trigger mode block (0x85 / 0x86). The first byte is its size, followed by one TriggerMode per slot.
+ */
+typedef std::array<uint8_t, 16> TriggerModeBlock;
+
+/**
+ * Compares the meaningful bytes of two packets, ignoring anything past their size.
+ */
+bool samePacket(const ConfigPacket &a, const ConfigPacket &b);
+
+/**
+ * Compares the meaningful bytes of two trigger mode blocks, ignoring anything past their size.
+ */
+bool sameTriggerModes(const TriggerModeBlock &a, const TriggerModeBlock &b);
+
+PedalConfiguration parseConfig(const ConfigPacketView &packet);
+/**
+ * Packets which fail validation decode as unconfigured.
+ */
+PedalConfiguration parseConfig(const ConfigPacket &packet);
+ConfigPacket encodeConfigPacket(const Configuration &config);
@@ -0,0 +1,17 @@
+#include "ikkegol_session.hpp"
+#include "ikkegol_pedal.hpp"
+
+IkkegolSession::IkkegolSession(IkkegolPedal &pedal, bool reattachDriver)
+    : pedal(pedal), claimed(pedal.acquireInterface(reattachDriver)) {
+}
+
+IkkegolSession::~IkkegolSession() {
+    end();
+}
+
+void IkkegolSession::end() {
+    if (claimed) {
+        claimed = false;
+        pedal.releaseInterface();
+    }
+}
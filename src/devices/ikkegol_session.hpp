@@ -0,0 +1,35 @@
+#pragma once
+
+class IkkegolPedal;
+
+/**
+ * Keeps the config interface of a device claimed for as long as it exists, so a sequence of operations claims it
+ * (and detaches the kernel driver from it) only once. Operations run outside of a session claim the interface for
+ * themselves. Sessions nest, only the outermost one claims and releases the interface.
+ */
+class IkkegolSession {
+public:
+    /**
+     * Opens the device if needed and claims its config interface.
+     * @param reattachDriver Whether the kernel driver gets the interface back at the end. Ignored when nested
+     */
+    explicit IkkegolSession(IkkegolPedal &pedal, bool reattachDriver = true);
+    ~IkkegolSession();
+
+    IkkegolSession(const IkkegolSession &) = delete;
+    IkkegolSession &operator=(const IkkegolSession &) = delete;
+
+    /**
+     * @returns true if the interface is claimed. Otherwise the reason is in IkkegolPedal::getLastError()
+     */
+    bool isClaimed() const { return claimed; }
+
+    /**
+     * Releases the interface before the session goes out of scope.
+     */
+    void end();
+
+private:
+    IkkegolPedal &pedal;
+    bool claimed;
+};
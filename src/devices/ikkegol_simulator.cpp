@@ -0,0 +1,304 @@
+#include "ikkegol_simulator.hpp"
+#include "ikkegol_protocol.hpp"
+#include "ikkegol_capabilities.hpp"
+#include "usbmon_capture.hpp"
+#include "../utils/string_utils.hpp"
+#include "../utils/command_line.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// The config endpoint pair a real device uses
+const uint8_t EndpointOut = 0x02;
+const uint8_t EndpointIn = 0x82;
+
+SimulatorProfile makeDefaultSimulatorProfile(const std::string &model, std::chrono::microseconds latency) {
+    SimulatorProfile profile;
+    profile.model = model;
+    profile.outLatency = latency;
+    profile.defaultLatency = latency;
+    if (latency.count() > 0) {
+        // Each transfer takes one poll
+        profile.endpointTiming = EndpointTiming { latency, latency };
+    }
+
+    // The version string is zero padded to a whole number of pages
+    auto versionString = model + "_VSIM";
+    profile.versionResponse.assign(versionString.begin(), versionString.end());
+    profile.versionResponse.resize((versionString.size() + 8) & ~7);
+
+    return profile;
+}
+
+IkkegolSimulator::IkkegolSimulator(const SimulatorProfile &profile, std::string portPath)
+    : portPath(std::move(portPath)), outLatency(profile.outLatency), responseLatency(profile.responseLatency),
+      defaultLatency(profile.defaultLatency), endpointTiming(profile.endpointTiming), faults(profile.faults), random(profile.faults.seed),
+      versionResponse(profile.versionResponse) {
+    Capabilities capabilities;
+    auto caps = getModelCapabilities(profile.model);
+    if (caps) {
+        capabilities = *caps;
+    }
+
+    // Each pedal starts out as a different letter key unless the profile says otherwise
+    slots.resize(capabilities.pedals + capabilities.firstPedalIndex);
+    for (size_t slot = 0; slot < slots.size(); ++slot) {
+        slots[slot] = { 0x08, CT_KEYBOARD, 0x00, static_cast<uint8_t>(0x04 + slot) };
+    }
+    for (auto &[slot, contents]: profile.slots) {
+        if (slot < slots.size()) {
+            slots[slot] = contents;
+        }
+    }
+
+    if (profile.triggerModes) {
+        triggerModes = *profile.triggerModes;
+    } else {
+        triggerModes[0] = static_cast<uint8_t>(slots.size() + 1);
+        std::fill_n(&triggerModes[1], slots.size(), TM_PRESS);
+    }
+}
+
+int IkkegolSimulator::submitOut(const uint8_t *data, int length, Callback callback) {
+    Request request;
+    request.endpoint = EndpointOut;
+    std::memcpy(request.outData, data, std::min<size_t>(length, sizeof(request.outData)));
+    request.length = length;
+    request.callback = callback;
+
+    outQueue.push_back(std::move(request));
+    return 0;
+}
+
+int IkkegolSimulator::submitIn(uint8_t *buffer, int length, Callback callback) {
+    Request request;
+    request.endpoint = EndpointIn;
+    request.buffer = buffer;
+    request.length = length;
+    request.callback = callback;
+
+    inQueue.push_back(std::move(request));
+    return 0;
+}
+
+int IkkegolSimulator::wait(std::chrono::milliseconds idleTimeout) {
+    while (!outQueue.empty() || !inQueue.empty()) {
+        // The device always consumes requests before it can produce a response to them
+        if (!outQueue.empty()) {
+            auto request = std::move(outQueue.front());
+            outQueue.pop_front();
+            // Only point at the data once the request has stopped moving around
+            request.buffer = request.outData;
+
+            std::this_thread::sleep_for(outLatency);
+            if (injectFault(faults.stall)) {
+                outQueue.clear();
+                inQueue.clear();
+                return LIBUSB_ERROR_PIPE;
+            }
+
+            handlePacket(request.buffer, request.length);
+            request.actualLength = request.length;
+            complete(request);
+            continue;
+        }
+
+        if (responses.empty()) {
+            return timeOut(idleTimeout);
+        }
+
+        if (injectFault(faults.droppedPage)) {
+            responses.pop_front();
+            ++responsePage;
+            continue;
+        }
+
+        auto latency = nextResponseLatency();
+        if (injectFault(faults.delayedResponse)) {
+            latency += faults.delayDuration;
+            if (latency >= idleTimeout) {
+                // The page is still there for whoever reads next, it just arrives too late for this transfer
+                return timeOut(idleTimeout);
+            }
+        }
+        std::this_thread::sleep_for(latency);
+
+        if (injectFault(faults.stall)) {
+            inQueue.clear();
+            return LIBUSB_ERROR_PIPE;
+        }
+
+        auto request = std::move(inQueue.front());
+        inQueue.pop_front();
+
+        if (injectFault(faults.zeroLengthRead)) {
+            request.actualLength = 0;
+        } else {
+            auto &response = responses.front();
+            request.actualLength = std::min<int>(request.length, response.size());
+            if (request.actualLength > 1 && injectFault(faults.shortRead)) {
+                request.actualLength = std::uniform_int_distribution<int>(1, request.actualLength - 1)(random);
+            }
+            std::memcpy(request.buffer, response.data(), request.actualLength);
+            responses.pop_front();
+        }
+
+        complete(request);
+    }
+
+    return 0;
+}
+
+int IkkegolSimulator::timeOut(std::chrono::milliseconds idleTimeout) {
+    // Nothing to send. A real device would leave the transfer pending until it times out, there is usually no
+    // need to actually wait for that here.
+    if (faults.realTimeouts) {
+        std::this_thread::sleep_for(idleTimeout);
+    }
+
+    outQueue.clear();
+    inQueue.clear();
+    return LIBUSB_ERROR_TIMEOUT;
+}
+
+bool IkkegolSimulator::injectFault(double probability) {
+    if (!faultsEnabled || probability <= 0) {
+        return false;
+    }
+
+    return std::uniform_real_distribution<double>(0, 1)(random) < probability;
+}
+
+void IkkegolSimulator::handlePacket(const uint8_t *data, int length) {
+    if (writeExpected > 0) {
+        // Payload pages following a write request
+        auto count = std::min(length, writeExpected - writeReceived);
+        auto stored = std::min(count, writeCapacity - writeReceived);
+        if (writeTarget != nullptr && stored > 0) {
+            std::memcpy(&writeTarget[writeReceived], data, stored);
+        }
+        writeReceived += count;
+        if (writeReceived >= writeExpected) {
+            writeExpected = 0;
+            writeTarget = nullptr;
+        }
+        return;
+    }
+
+    if (length < 8 || data[0] != 0x01) {
+        // Not a request
+        return;
+    }
+
+    // A new request discards anything not yet read from the previous one
+    responses.clear();
+    currentOpcode = data[1];
+    responsePage = 0;
+
+    auto slot = static_cast<size_t>(data[3]) - 1;
+    switch (data[1]) {
+        case 0x80:
+            // Begin write. Nothing to do
+            break;
+        case 0x81:
+            writeExpected = ((data[2] + 7) & ~7);
+            writeReceived = 0;
+            writeTarget = (slot < slots.size()) ? slots[slot].data() : nullptr;
+            writeCapacity = 0;
+            if (writeTarget != nullptr) {
+                writeCapacity = static_cast<int>(slots[slot].size());
+                std::fill_n(writeTarget, slots[slot].size(), 0);
+            }
+            break;
+        case 0x82:
+            if (slot < slots.size()) {
+                // Slots imported from a capture may claim to be larger than they are
+                auto size = std::clamp<int>(slots[slot][0], 1, static_cast<int>(slots[slot].size()));
+                respond(slots[slot].data(), size);
+            }
+            break;
+        case 0x83:
+            respond(versionResponse.data(), static_cast<int>(std::min<size_t>(versionResponse.size(), 32)));
+            break;
+        case 0x85:
+            writeExpected = ((data[2] + 7) & ~7);
+            writeReceived = 0;
+            writeTarget = triggerModes.data();
+            writeCapacity = static_cast<int>(triggerModes.size());
+            break;
+        case 0x86:
+            respond(triggerModes.data(), std::min<int>(triggerModes[0], static_cast<int>(triggerModes.size())));
+            break;
+        default:
+            // Not used by pedalctl
+            break;
+    }
+}
+
+void IkkegolSimulator::complete(Request &request) {
+    if (completionListener) {
+        completionListener(request);
+    }
+    if (request.callback) {
+        request.callback(request);
+    }
+}
+
+void IkkegolSimulator::respond(const uint8_t *data, int length) {
+    for (auto offset = 0; offset < length; offset += 8) {
+        std::array<uint8_t, 8> page {};
+        std::memcpy(page.data(), &data[offset], std::min(8, length - offset));
+        responses.push_back(page);
+    }
+}
+
+std::chrono::microseconds IkkegolSimulator::nextResponseLatency() {
+    auto page = responsePage++;
+
+    auto it = responseLatency.find(currentOpcode);
+    if (it != responseLatency.end() && page < it->second.size()) {
+        return it->second[page];
+    }
+
+    return defaultLatency;
+}
+
+std::vector<std::unique_ptr<IkkegolTransport>> createSimulatedTransports() {
+    std::vector<std::unique_ptr<IkkegolTransport>> transports;
+
+    auto models = std::getenv("PEDALCTL_SIMULATE");
+    if (models != nullptr && models[0] != '\0') {
+        std::chrono::microseconds latency(0);
+        auto rawLatency = std::getenv("PEDALCTL_SIMULATE_LATENCY");
+        if (rawLatency != nullptr) {
+            auto parsed = parseInt(std::string(rawLatency));
+            if (parsed && *parsed > 0) {
+                latency = std::chrono::microseconds(*parsed);
+            }
+        }
+
+        for (auto &model: split(models, ',')) {
+            if (model.empty()) {
+                continue;
+            }
+            transports.push_back(std::make_unique<IkkegolSimulator>(
+                makeDefaultSimulatorProfile(model, latency), "sim-" + std::to_string(transports.size() + 1)
+            ));
+        }
+    }
+
+    auto captures = std::getenv("PEDALCTL_SIMULATE_PCAP");
+    if (captures != nullptr && captures[0] != '\0') {
+        int index = 1;
+        for (auto &path: split(captures, ',')) {
+            auto profile = loadUsbmonCapture(path);
+            if (!profile) {
+                continue;
+            }
+            transports.push_back(std::make_unique<IkkegolSimulator>(*profile, "pcap-" + std::to_string(index++)));
+        }
+    }
+
+    return transports;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "ikkegol_transport.hpp"
+#include "../utils/reusable_queue.hpp"
+#include <array>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+/**
+ * Misbehaviour to inject into a simulated device. Each probability is rolled independently per transfer.
+ */
+struct SimulatorFaults {
+    // An IN page is lost. The transfer stays pending and receives the next page, if any
+    double droppedPage { 0 };
+    // The endpoint stalls. The transfer fails with LIBUSB_ERROR_PIPE and everything else in flight is cancelled
+    double stall { 0 };
+    // An IN transfer completes with only part of the page
+    double shortRead { 0 };
+    // An IN transfer completes with no data, leaving the page to be read by the next transfer
+    double zeroLengthRead { 0 };
+    // A response is held back by delayDuration. If this exceeds the idle timeout of wait(), it times out
+    double delayedResponse { 0 };
+    std::chrono::microseconds delayDuration { 20000 };
+
+    // Spend the full idle timeout before reporting a timeout, like a real device would
+    bool realTimeouts { false };
+    uint32_t seed { 1 };
+};
+
+/**
+ * Describes the initial state and response timing of a simulated device.
+ */
+struct SimulatorProfile {
+    std::string model;
+    // Raw response to the version request (0x83)
+    std::vector<uint8_t> versionResponse;
+    // Raw response to the read configuration request (0x82) for each slot
+    std::map<size_t, std::array<uint8_t, 40>> slots;
+    // Raw response to the read trigger modes request (0x86)
+    std::optional<std::array<uint8_t, 16>> triggerModes;
+
+    // Time taken to accept each OUT transfer
+    std::chrono::microseconds outLatency { 0 };
+    // Time until each page of a response is available, measured from the previous page (or the request).
+    // Pages without a measurement use defaultLatency
+    std::map<uint8_t, std::vector<std::chrono::microseconds>> responseLatency;
+    std::chrono::microseconds defaultLatency { 0 };
+    // The polling interval the endpoint descriptors claim, if any
+    std::optional<EndpointTiming> endpointTiming;
+
+    SimulatorFaults faults;
+};
+
+SimulatorProfile makeDefaultSimulatorProfile(const std::string &model, std::chrono::microseconds latency);
+
+/**
+ * An in-process emulation of the pedal firmware (FS2020U1IR and FS2017U1IR).
+ * Implements the 0x80 - 0x86 config opcodes with 8 byte paging so the full protocol can be exercised without
+ * hardware. Transfers complete as fast as the profile allows, subject to any faults it injects.
+ */
+class IkkegolSimulator : public IkkegolTransport {
+public:
+    explicit IkkegolSimulator(const SimulatorProfile &profile, std::string portPath);
+
+    int open() override { return 0; }
+
+    int claimInterface(bool) override { return 0; }
+    void releaseInterface() override {}
+
+    int submitOut(const uint8_t *data, int length, Callback callback) override;
+    int submitIn(uint8_t *buffer, int length, Callback callback) override;
+    int wait(std::chrono::milliseconds idleTimeout) override;
+    void setCompletionListener(CompletionListener listener) override { completionListener = std::move(listener); }
+    int clearHalt() override { return 0; }
+
+    std::string getPortPath() const override { return portPath; }
+
+    std::optional<EndpointTiming> getEndpointTiming() const override { return endpointTiming; }
+
+    /**
+     * Faults are only injected while enabled, which is the default when the profile has any.
+     */
+    void setFaultsEnabled(bool enabled) { faultsEnabled = enabled; }
+
+    /**
+     * The raw contents of a config slot, as the firmware currently holds it.
+     */
+    const std::array<uint8_t, 40> &getSlot(size_t slot) const { return slots.at(slot); }
+
+    const std::array<uint8_t, 16> &getTriggerModes() const { return triggerModes; }
+
+private:
+    struct Request : USBTransfer {
+        Callback callback;
+        uint8_t outData[8] {};
+    };
+
+    std::string portPath;
+    // Reused between exchanges so that, like a real transport, a simulated device does not allocate once warm
+    ReusableQueue<Request> outQueue;
+    ReusableQueue<Request> inQueue;
+    CompletionListener completionListener;
+
+    // Timing
+    std::chrono::microseconds outLatency;
+    std::map<uint8_t, std::vector<std::chrono::microseconds>> responseLatency;
+    std::chrono::microseconds defaultLatency;
+    std::optional<EndpointTiming> endpointTiming;
+    uint8_t currentOpcode { 0 };
+    size_t responsePage { 0 };
+
+    // Fault injection
+    SimulatorFaults faults;
+    bool faultsEnabled { true };
+    std::mt19937 random;
+
+    // Firmware state
+    std::vector<uint8_t> versionResponse;
+    std::vector<std::array<uint8_t, 40>> slots;
+    std::array<uint8_t, 16> triggerModes {};
+    ReusableQueue<std::array<uint8_t, 8>> responses;
+    uint8_t *writeTarget {};
+    // The size of what writeTarget points to. Payload beyond it is accepted but dropped
+    int writeCapacity { 0 };
+    int writeExpected { 0 };
+    int writeReceived { 0 };
+
+    void handlePacket(const uint8_t *data, int length);
+    void respond(const uint8_t *data, int length);
+    void complete(Request &request);
+    std::chrono::microseconds nextResponseLatency();
+    bool injectFault(double probability);
+    int timeOut(std::chrono::milliseconds idleTimeout);
+};
+
+/**
+ * Creates the simulated devices requested through the environment.
+ * PEDALCTL_SIMULATE is a comma separated list of models. PEDALCTL_SIMULATE_LATENCY is an optional per-transfer
+ * latency in microseconds. PEDALCTL_SIMULATE_PCAP is a comma separated list of usbmon captures to model devices on.
+ */
+std::vector<std::unique_ptr<IkkegolTransport>> createSimulatedTransports();
@@ -0,0 +1,290 @@
+#include "ikkegol_trace.hpp"
+#include "../utils/string_utils.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+const char TraceMagic[8] = { 'P', 'C', 'T', 'L', 'T', 'R', 'C', '1' };
+const size_t TraceRecordSize = 19;
+
+void encodeTraceRecord(const TraceRecord &record, uint8_t *out) {
+    for (auto byte = 0; byte < 4; ++byte) {
+        out[byte] = static_cast<uint8_t>(record.timestamp >> (byte * 8));
+        out[4 + byte] = static_cast<uint8_t>(record.latency >> (byte * 8));
+    }
+    out[8] = record.endpoint;
+    out[9] = static_cast<uint8_t>(record.result);
+    out[10] = record.length;
+    std::memcpy(&out[11], record.data, sizeof(record.data));
+}
+
+void decodeTraceRecord(const uint8_t *in, TraceRecord &record) {
+    record.timestamp = 0;
+    record.latency = 0;
+    for (auto byte = 0; byte < 4; ++byte) {
+        record.timestamp |= static_cast<uint32_t>(in[byte]) << (byte * 8);
+        record.latency |= static_cast<uint32_t>(in[4 + byte]) << (byte * 8);
+    }
+    record.endpoint = in[8];
+    record.result = static_cast<int8_t>(in[9]);
+    record.length = std::min<uint8_t>(in[10], sizeof(record.data));
+    std::memcpy(record.data, &in[11], sizeof(record.data));
+}
+
+bool readTrace(const std::string &path, std::vector<TraceRecord> &records) {
+    auto file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    char magic[sizeof(TraceMagic)];
+    if (std::fread(magic, sizeof(magic), 1, file) != 1 || std::memcmp(magic, TraceMagic, sizeof(magic)) != 0) {
+        std::fclose(file);
+        return false;
+    }
+
+    uint8_t buffer[TraceRecordSize];
+    while (std::fread(buffer, sizeof(buffer), 1, file) == 1) {
+        TraceRecord record {};
+        decodeTraceRecord(buffer, record);
+        records.push_back(record);
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+IkkegolRecordingTransport::IkkegolRecordingTransport(std::unique_ptr<IkkegolTransport> inner, const std::string &path)
+    : inner(std::move(inner)), path(path) {
+    this->inner->setCompletionListener([this](USBTransfer &transfer) {
+        onTransferComplete(transfer);
+    });
+}
+
+size_t traceDirection(uint8_t endpoint) {
+    return (endpoint == TraceEndpointIn) ? 1 : 0;
+}
+
+IkkegolRecordingTransport::~IkkegolRecordingTransport() {
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+int IkkegolRecordingTransport::open() {
+    auto result = inner->open();
+    if (result < 0) {
+        return result;
+    }
+
+    if (!file) {
+        file = std::fopen(path.c_str(), "wb");
+        if (file) {
+            std::fwrite(TraceMagic, sizeof(TraceMagic), 1, file);
+        }
+        start = std::chrono::steady_clock::now();
+    }
+
+    return 0;
+}
+
+int IkkegolRecordingTransport::submitOut(const uint8_t *data, int length, Callback callback) {
+    submitted(TraceEndpointOut);
+    return inner->submitOut(data, length, callback);
+}
+
+int IkkegolRecordingTransport::submitIn(uint8_t *buffer, int length, Callback callback) {
+    submitted(TraceEndpointIn);
+    return inner->submitIn(buffer, length, callback);
+}
+
+void IkkegolRecordingTransport::submitted(uint8_t endpoint) {
+    outstanding[traceDirection(endpoint)].push_back({ nextTransferId++, endpoint, std::chrono::steady_clock::now() });
+}
+
+void IkkegolRecordingTransport::onTransferComplete(USBTransfer &transfer) {
+    auto &queue = outstanding[traceDirection(transfer.endpoint)];
+    if (!queue.empty()) {
+        auto &front = queue.front();
+        record(front.endpoint, front.submitted, transfer.result, transfer.buffer, transfer.actualLength);
+        queue.pop_front();
+    }
+
+    if (completionListener) {
+        completionListener(transfer);
+    }
+}
+
+int IkkegolRecordingTransport::wait(std::chrono::milliseconds idleTimeout) {
+    auto result = inner->wait(idleTimeout);
+
+    // Only successful transfers complete. Whatever is left failed with this result, and is recorded in the order it
+    // was submitted.
+    auto &outQueue = outstanding[0];
+    auto &inQueue = outstanding[1];
+    while (!outQueue.empty() || !inQueue.empty()) {
+        bool takeOut = inQueue.empty() || (!outQueue.empty() && outQueue.front().id < inQueue.front().id);
+        auto &queue = takeOut ? outQueue : inQueue;
+
+        auto &transfer = queue.front();
+        record(transfer.endpoint, transfer.submitted, result < 0 ? result : LIBUSB_ERROR_IO, nullptr, 0);
+        queue.pop_front();
+    }
+
+    return result;
+}
+
+void IkkegolRecordingTransport::record(
+    uint8_t endpoint, std::chrono::steady_clock::time_point submitted, int result, const uint8_t *data, int length
+) {
+    if (!file) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto timestamp = std::chrono::duration_cast<std::chrono::microseconds>(now - start);
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - submitted);
+
+    TraceRecord record {};
+    record.timestamp = static_cast<uint32_t>(timestamp.count());
+    record.latency = static_cast<uint32_t>(latency.count());
+    record.endpoint = endpoint;
+    record.result = static_cast<int8_t>(result);
+    record.length = static_cast<uint8_t>(std::clamp(length, 0, 8));
+    if (data != nullptr) {
+        std::memcpy(record.data, data, record.length);
+    }
+
+    uint8_t buffer[TraceRecordSize];
+    encodeTraceRecord(record, buffer);
+    std::fwrite(buffer, sizeof(buffer), 1, file);
+}
+
+IkkegolReplayTransport::IkkegolReplayTransport(std::vector<TraceRecord> records, int index)
+    : records(std::move(records)), index(index) {
+}
+
+int IkkegolReplayTransport::submitOut(const uint8_t *data, int length, Callback callback) {
+    Request request;
+    request.endpoint = TraceEndpointOut;
+    std::memcpy(request.outData, data, std::min<size_t>(length, sizeof(request.outData)));
+    request.length = length;
+    request.callback = callback;
+
+    outQueue.push_back(std::move(request));
+    return 0;
+}
+
+int IkkegolReplayTransport::submitIn(uint8_t *buffer, int length, Callback callback) {
+    Request request;
+    request.endpoint = TraceEndpointIn;
+    request.buffer = buffer;
+    request.length = length;
+    request.callback = callback;
+
+    inQueue.push_back(std::move(request));
+    return 0;
+}
+
+bool IkkegolReplayTransport::matchesRecord(const Request &request, const TraceRecord &record) {
+    return request.length == record.length && std::memcmp(request.outData, record.data, record.length) == 0;
+}
+
+int IkkegolReplayTransport::wait(std::chrono::milliseconds) {
+    int firstError = 0;
+
+    while (!outQueue.empty() || !inQueue.empty()) {
+        if (nextRecord >= records.size()) {
+            // The capture ended here. Anything else would never have been answered
+            firstError = LIBUSB_ERROR_TIMEOUT;
+            break;
+        }
+
+        auto &record = records[nextRecord];
+        auto &queue = (record.endpoint == TraceEndpointOut) ? outQueue : inQueue;
+        if (queue.empty()) {
+            // The host is waiting on the other endpoint to what the capture has next. Replay has diverged
+            firstError = LIBUSB_ERROR_TIMEOUT;
+            break;
+        }
+        if (record.endpoint == TraceEndpointOut && record.result >= 0 && !matchesRecord(queue.front(), record)) {
+            // The host sent something other than what was captured, so the responses that follow are for another
+            // request. Replay has diverged
+            firstError = LIBUSB_ERROR_IO;
+            break;
+        }
+
+        ++nextRecord;
+
+        // Reproduce the pacing of the original device
+        if (lastTimestamp && record.timestamp > *lastTimestamp) {
+            std::this_thread::sleep_for(std::chrono::microseconds(record.timestamp - *lastTimestamp));
+        }
+        lastTimestamp = record.timestamp;
+
+        auto request = std::move(queue.front());
+        queue.pop_front();
+
+        if (record.result < 0) {
+            firstError = record.result;
+            break;
+        }
+
+        if (record.endpoint == TraceEndpointOut) {
+            request.buffer = request.outData;
+            request.actualLength = request.length;
+        } else {
+            request.actualLength = std::min<int>(request.length, record.length);
+            std::memcpy(request.buffer, record.data, request.actualLength);
+        }
+
+        if (completionListener) {
+            completionListener(request);
+        }
+        if (request.callback) {
+            request.callback(request);
+        }
+    }
+
+    if (firstError < 0) {
+        // Transfers which failed along with it were recorded straight after
+        while (nextRecord < records.size() && records[nextRecord].result < 0) {
+            ++nextRecord;
+        }
+        outQueue.clear();
+        inQueue.clear();
+    }
+
+    return firstError;
+}
+
+std::unique_ptr<IkkegolTransport> recordTransportIfRequested(std::unique_ptr<IkkegolTransport> transport) {
+    auto directory = std::getenv("PEDALCTL_RECORD");
+    if (directory == nullptr || directory[0] == '\0') {
+        return transport;
+    }
+
+    auto path = std::string(directory) + "/" + transport->getPortPath() + ".trace";
+    return std::make_unique<IkkegolRecordingTransport>(std::move(transport), path);
+}
+
+std::vector<std::unique_ptr<IkkegolTransport>> createReplayTransports() {
+    auto paths = std::getenv("PEDALCTL_REPLAY");
+    if (paths == nullptr || paths[0] == '\0') {
+        return {};
+    }
+
+    std::vector<std::unique_ptr<IkkegolTransport>> transports;
+    for (auto &path: split(paths, ',')) {
+        std::vector<TraceRecord> records;
+        if (path.empty() || !readTrace(path, records)) {
+            continue;
+        }
+        transports.push_back(std::make_unique<IkkegolReplayTransport>(
+            std::move(records), static_cast<int>(transports.size() + 1)
+        ));
+    }
+
+    return transports;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "ikkegol_transport.hpp"
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <vector>
+
+/**
+ * A single transfer as stored in a trace file.
+ *
+ * Trace files start with the 8 byte magic "PCTLTRC1" followed by fixed size little-endian records:
+ *   uint32 timestamp (µs since the transport was opened, at completion)
+ *   uint32 latency   (µs from submission to completion)
+ *   uint8  endpoint  (0x02 for OUT, 0x82 for IN)
+ *   int8   result    (0 or a LIBUSB_ERROR_* code)
+ *   uint8  length    (bytes actually transferred)
+ *   uint8  data[8]
+ */
+struct TraceRecord {
+    uint32_t timestamp;
+    uint32_t latency;
+    uint8_t endpoint;
+    int8_t result;
+    uint8_t length;
+    uint8_t data[8];
+};
+
+constexpr uint8_t TraceEndpointOut = 0x02;
+constexpr uint8_t TraceEndpointIn = 0x82;
+
+bool readTrace(const std::string &path, std::vector<TraceRecord> &records);
+
+/**
+ * Passes everything through to another transport while recording each transfer to a trace file.
+ */
+class IkkegolRecordingTransport : public IkkegolTransport {
+public:
+    explicit IkkegolRecordingTransport(std::unique_ptr<IkkegolTransport>, const std::string &path);
+    ~IkkegolRecordingTransport() override;
+
+    int open() override;
+
+    int claimInterface(bool reattachDriver) override { return inner->claimInterface(reattachDriver); }
+    void releaseInterface() override { inner->releaseInterface(); }
+
+    int submitOut(const uint8_t *data, int length, Callback callback) override;
+    int submitIn(uint8_t *buffer, int length, Callback callback) override;
+    int wait(std::chrono::milliseconds idleTimeout) override;
+    void setCompletionListener(CompletionListener listener) override { completionListener = std::move(listener); }
+    int clearHalt() override { return inner->clearHalt(); }
+
+    std::string getPortPath() const override { return inner->getPortPath(); }
+
+    std::optional<EndpointTiming> getEndpointTiming() const override { return inner->getEndpointTiming(); }
+
+    // Not cached so that every trace includes the model / version handshake
+
+private:
+    struct Outstanding {
+        uint64_t id;
+        uint8_t endpoint;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    std::unique_ptr<IkkegolTransport> inner;
+    std::string path;
+    FILE *file {};
+    std::chrono::steady_clock::time_point start;
+    // Transfers complete in order on each endpoint. Indexed by direction, OUT then IN
+    std::deque<Outstanding> outstanding[2];
+    uint64_t nextTransferId { 0 };
+    CompletionListener completionListener;
+
+    void submitted(uint8_t endpoint);
+    void onTransferComplete(USBTransfer &transfer);
+    void record(uint8_t endpoint, std::chrono::steady_clock::time_point submitted, int result, const uint8_t *data, int length);
+};
+
+/**
+ * Serves the responses from a trace file back in order, with the same pacing as the original device.
+ */
+class IkkegolReplayTransport : public IkkegolTransport {
+public:
+    explicit IkkegolReplayTransport(std::vector<TraceRecord> records, int index);
+
+    int open() override { return 0; }
+
+    int claimInterface(bool) override { return 0; }
+    void releaseInterface() override {}
+
+    int submitOut(const uint8_t *data, int length, Callback callback) override;
+    int submitIn(uint8_t *buffer, int length, Callback callback) override;
+    int wait(std::chrono::milliseconds idleTimeout) override;
+    void setCompletionListener(CompletionListener listener) override { completionListener = std::move(listener); }
+    int clearHalt() override { return 0; }
+
+    std::string getPortPath() const override { return "replay-" + std::to_string(index); }
+
+private:
+    struct Request : USBTransfer {
+        Callback callback;
+        uint8_t outData[8] {};
+    };
+
+    /**
+     * Whether an OUT request sends exactly what was captured.
+     */
+    static bool matchesRecord(const Request &request, const TraceRecord &record);
+
+    std::vector<TraceRecord> records;
+    size_t nextRecord { 0 };
+    std::optional<uint32_t> lastTimestamp;
+    int index;
+    std::deque<Request> outQueue;
+    std::deque<Request> inQueue;
+    CompletionListener completionListener;
+};
+
+/**
+ * Wraps the transport in a recorder if PEDALCTL_RECORD names a directory to record into.
+ * Each device is recorded to <directory>/<port path>.trace
+ */
+std::unique_ptr<IkkegolTransport> recordTransportIfRequested(std::unique_ptr<IkkegolTransport> transport);
+
+/**
+ * Creates a replayed device for each trace file listed (comma separated) in PEDALCTL_REPLAY.
+ */
+std::vector<std::unique_ptr<IkkegolTransport>> createReplayTransports();
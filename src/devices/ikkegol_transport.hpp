@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ikkegol_model_cache.hpp"
+#include "../utils/usb_transfer_queue.hpp"
+#include <chrono>
+#include <optional>
+#include <string>
+
+/**
+ * How often the host polls each of the config endpoints, as given by their descriptors.
+ */
+struct EndpointTiming {
+    std::chrono::microseconds inInterval;
+    std::chrono::microseconds outInterval;
+};
+
+/**
+ * The link between IkkegolPedal and a device.
+ * Transfers are always 8 byte interrupt packets on the config endpoint. Implementations must not invoke callbacks
+ * from within submitIn / submitOut, only from within wait(). Callbacks are referred to rather than copied, so they must
+ * stay valid until wait() returns.
+ */
+class IkkegolTransport {
+public:
+    typedef USBTransferQueue::Callback Callback;
+    typedef USBTransferQueue::CompletionListener CompletionListener;
+
+    virtual ~IkkegolTransport() = default;
+
+    /**
+     * @returns 0 on success, otherwise a LIBUSB_ERROR_* code
+     */
+    virtual int open() = 0;
+
+    /**
+     * Claims the config interface, detaching the kernel driver from it if needed.
+     * @param reattachDriver Whether the kernel driver gets the interface back once it is released
+     */
+    virtual int claimInterface(bool reattachDriver) = 0;
+    virtual void releaseInterface() = 0;
+
+    virtual int submitOut(const uint8_t *data, int length, Callback callback = {}) = 0;
+    virtual int submitIn(uint8_t *buffer, int length, Callback callback = {}) = 0;
+    virtual int wait(std::chrono::milliseconds idleTimeout) = 0;
+
+    /**
+     * Receives every transfer which completes, before its own callback. Observes all transfers without wrapping
+     * each callback.
+     */
+    virtual void setCompletionListener(CompletionListener listener) = 0;
+
+    /**
+     * Clears a stall on the config endpoints, so transfers can continue after one failed with LIBUSB_ERROR_PIPE.
+     */
+    virtual int clearHalt() = 0;
+
+    virtual std::string getPortPath() const = 0;
+
+    /**
+     * The identity used for the model cache. Devices which cannot be reliably identified should not be cached.
+     */
+    virtual std::optional<ModelCacheKey> getCacheKey() const { return {}; }
+
+    /**
+     * The polling intervals of the config endpoints, if known. Only valid once opened.
+     */
+    virtual std::optional<EndpointTiming> getEndpointTiming() const { return {}; }
+};
@@ -0,0 +1,172 @@
+#include "ikkegol_usb_transport.hpp"
+#include <algorithm>
+
+const int ConfigInterface = 1;
+const uint8_t ConfigEndpoint = 0x02;
+// USB 3.0 allows at most 7 tiers
+const int MaxPortDepth = 7;
+// How long it can take between a transfer completing and the next one being submitted. Enough transfers are kept
+// in flight to cover this, so the endpoint is never left idle at a poll.
+const std::chrono::microseconds ResubmitLatency(4000);
+const size_t MinQueueDepth = 2;
+const size_t MaxQueueDepth = 16;
+
+/**
+ * Converts bInterval into time. Low and full speed devices give it in frames (1 ms), faster ones as an exponent
+ * of microframes (125 us).
+ */
+std::chrono::microseconds decodePollingInterval(uint8_t interval, int speed) {
+    if (speed == LIBUSB_SPEED_LOW || speed == LIBUSB_SPEED_FULL || speed == LIBUSB_SPEED_UNKNOWN) {
+        return std::chrono::milliseconds(std::max<uint8_t>(interval, 1));
+    }
+
+    auto exponent = std::clamp<uint8_t>(interval, 1, 16) - 1;
+    return std::chrono::microseconds(125 << exponent);
+}
+
+IkkegolUSBTransport::IkkegolUSBTransport(libusb_device *device)
+    : device(libusb_ref_device(device)), portPath(getUSBPortPath(device)) {
+    libusb_get_device_descriptor(device, &descriptor);
+}
+
+IkkegolUSBTransport::~IkkegolUSBTransport() {
+    transfers.reset();
+    if (handle) {
+        libusb_close(handle);
+    }
+    libusb_unref_device(device);
+}
+
+int IkkegolUSBTransport::open() {
+    if (handle) {
+        return 0;
+    }
+
+    auto result = libusb_open(device, &handle);
+    if (result < 0) {
+        handle = nullptr;
+        return result;
+    }
+
+    transfers = std::make_unique<USBTransferQueue>(handle, ConfigEndpoint);
+    transfers->setCompletionListener(completionListener);
+
+    readEndpointTiming();
+    if (endpointTiming) {
+        auto interval = std::min(endpointTiming->inInterval, endpointTiming->outInterval);
+        auto depth = static_cast<size_t>((ResubmitLatency + interval - std::chrono::microseconds(1)) / interval) + 1;
+        transfers->setMaxInFlight(std::clamp(depth, MinQueueDepth, MaxQueueDepth));
+    }
+
+    return 0;
+}
+
+void IkkegolUSBTransport::readEndpointTiming() {
+    libusb_config_descriptor *config;
+    if (libusb_get_active_config_descriptor(device, &config) < 0) {
+        return;
+    }
+
+    auto speed = libusb_get_device_speed(device);
+    std::optional<std::chrono::microseconds> inInterval;
+    std::optional<std::chrono::microseconds> outInterval;
+
+    for (auto index = 0; index < config->bNumInterfaces; ++index) {
+        auto &interface = config->interface[index];
+        if (interface.num_altsetting < 1 || interface.altsetting[0].bInterfaceNumber != ConfigInterface) {
+            continue;
+        }
+
+        auto &settings = interface.altsetting[0];
+        for (auto endpointIndex = 0; endpointIndex < settings.bNumEndpoints; ++endpointIndex) {
+            auto &endpoint = settings.endpoint[endpointIndex];
+            if ((endpoint.bmAttributes & LIBUSB_TRANSFER_TYPE_MASK) != LIBUSB_TRANSFER_TYPE_INTERRUPT ||
+                (endpoint.bEndpointAddress & LIBUSB_ENDPOINT_ADDRESS_MASK) != ConfigEndpoint) {
+                continue;
+            }
+
+            auto interval = decodePollingInterval(endpoint.bInterval, speed);
+            if ((endpoint.bEndpointAddress & LIBUSB_ENDPOINT_DIR_MASK) == LIBUSB_ENDPOINT_IN) {
+                inInterval = interval;
+            } else {
+                outInterval = interval;
+            }
+        }
+    }
+
+    libusb_free_config_descriptor(config);
+
+    if (inInterval && outInterval) {
+        endpointTiming = EndpointTiming { *inInterval, *outInterval };
+    }
+}
+
+int IkkegolUSBTransport::claimInterface(bool reattachDriver) {
+    if (reattachDriver) {
+        // libusb gives the interface back to the driver on release
+        libusb_set_auto_detach_kernel_driver(handle, 1);
+    } else {
+        libusb_set_auto_detach_kernel_driver(handle, 0);
+        if (libusb_kernel_driver_active(handle, ConfigInterface) == 1) {
+            auto result = libusb_detach_kernel_driver(handle, ConfigInterface);
+            if (result < 0 && result != LIBUSB_ERROR_NOT_FOUND) {
+                return result;
+            }
+        }
+    }
+
+    return libusb_claim_interface(handle, ConfigInterface);
+}
+
+void IkkegolUSBTransport::releaseInterface() {
+    libusb_release_interface(handle, ConfigInterface);
+}
+
+int IkkegolUSBTransport::submitOut(const uint8_t *data, int length, Callback callback) {
+    return transfers->submitOut(data, length, std::move(callback));
+}
+
+int IkkegolUSBTransport::submitIn(uint8_t *buffer, int length, Callback callback) {
+    return transfers->submitIn(buffer, length, std::move(callback));
+}
+
+int IkkegolUSBTransport::wait(std::chrono::milliseconds idleTimeout) {
+    return transfers->wait(idleTimeout);
+}
+
+void IkkegolUSBTransport::setCompletionListener(CompletionListener listener) {
+    completionListener = std::move(listener);
+    if (transfers) {
+        transfers->setCompletionListener(completionListener);
+    }
+}
+
+int IkkegolUSBTransport::clearHalt() {
+    auto result = libusb_clear_halt(handle, ConfigEndpoint);
+    if (result < 0) {
+        return result;
+    }
+
+    return libusb_clear_halt(handle, ConfigEndpoint | LIBUSB_ENDPOINT_IN);
+}
+
+std::optional<ModelCacheKey> IkkegolUSBTransport::getCacheKey() const {
+    return ModelCacheKey { portPath, libusb_get_device_address(device), descriptor.bcdDevice };
+}
+
+std::string getUSBPortPath(libusb_device *device) {
+    uint8_t ports[MaxPortDepth];
+    auto depth = libusb_get_port_numbers(device, ports, MaxPortDepth);
+
+    std::string path = std::to_string(libusb_get_bus_number(device));
+    if (depth <= 0) {
+        return path;
+    }
+
+    for (auto index = 0; index < depth; ++index) {
+        path.push_back(index == 0 ? '-' : '.');
+        path.append(std::to_string(ports[index]));
+    }
+
+    return path;
+}
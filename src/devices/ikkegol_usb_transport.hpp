@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ikkegol_transport.hpp"
+#include <libusb.h>
+#include <memory>
+
+/**
+ * Talks to a physical device through libusb.
+ */
+class IkkegolUSBTransport : public IkkegolTransport {
+public:
+    explicit IkkegolUSBTransport(libusb_device *);
+    ~IkkegolUSBTransport() override;
+
+    int open() override;
+
+    int claimInterface(bool reattachDriver) override;
+    void releaseInterface() override;
+
+    int submitOut(const uint8_t *data, int length, Callback callback) override;
+    int submitIn(uint8_t *buffer, int length, Callback callback) override;
+    int wait(std::chrono::milliseconds idleTimeout) override;
+    void setCompletionListener(CompletionListener listener) override;
+    int clearHalt() override;
+
+    std::string getPortPath() const override { return portPath; }
+
+    std::optional<ModelCacheKey> getCacheKey() const override;
+
+    std::optional<EndpointTiming> getEndpointTiming() const override { return endpointTiming; }
+
+private:
+    libusb_device *device;
+    libusb_device_descriptor descriptor {};
+    libusb_device_handle *handle {};
+    std::unique_ptr<USBTransferQueue> transfers;
+    // Kept until the queue is created on open()
+    CompletionListener completionListener;
+    std::string portPath;
+    std::optional<EndpointTiming> endpointTiming;
+
+    void readEndpointTiming();
+};
+
+std::string getUSBPortPath(libusb_device *device);
@@ -0,0 +1,290 @@
+#include "usbmon_capture.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+
+const uint32_t PcapMagicMicros = 0xa1b2c3d4;
+const uint32_t PcapMagicNanos = 0xa1b23c4d;
+const uint32_t LinkTypeUSBLinux = 189;
+const uint32_t LinkTypeUSBLinuxMMapped = 220;
+const size_t UsbmonHeaderSize = 48;
+const size_t UsbmonMMappedHeaderSize = 64;
+const uint8_t UsbmonTransferInterrupt = 1;
+const uint8_t UsbmonTransferControl = 2;
+
+const uint16_t CaptureVendorId = 0x1a86;
+const uint16_t CaptureProductId = 0xe026;
+const uint8_t CaptureEndpoint = 0x02;
+
+struct UsbmonEvent {
+    uint64_t urb;
+    char type;
+    uint8_t transferType;
+    uint8_t endpoint;
+    uint8_t device;
+    uint16_t bus;
+    int32_t status;
+    int64_t timestamp;
+    std::vector<uint8_t> data;
+};
+
+struct PcapReader {
+    FILE *file;
+    bool swapped;
+
+    uint16_t swap(uint16_t value) const {
+        return swapped ? static_cast<uint16_t>((value >> 8) | (value << 8)) : value;
+    }
+
+    uint32_t swap(uint32_t value) const {
+        return swapped ? __builtin_bswap32(value) : value;
+    }
+
+    uint64_t swap(uint64_t value) const {
+        return swapped ? __builtin_bswap64(value) : value;
+    }
+
+    template<typename T>
+    T field(const uint8_t *data, size_t offset) const {
+        T value;
+        std::memcpy(&value, &data[offset], sizeof(T));
+        return swap(value);
+    }
+};
+
+bool readUsbmonEvents(const std::string &path, std::vector<UsbmonEvent> &events) {
+    auto file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    uint8_t header[24];
+    if (std::fread(header, sizeof(header), 1, file) != 1) {
+        std::fclose(file);
+        return false;
+    }
+
+    uint32_t magic;
+    std::memcpy(&magic, header, sizeof(magic));
+
+    PcapReader reader { file, false };
+    if (magic != PcapMagicMicros && magic != PcapMagicNanos) {
+        reader.swapped = true;
+        magic = reader.swap(magic);
+        if (magic != PcapMagicMicros && magic != PcapMagicNanos) {
+            // Not a pcap file. pcapng is not supported
+            std::fclose(file);
+            return false;
+        }
+    }
+
+    bool nanos = (magic == PcapMagicNanos);
+    auto linkType = reader.field<uint32_t>(header, 20);
+    size_t usbmonHeaderSize;
+    if (linkType == LinkTypeUSBLinux) {
+        usbmonHeaderSize = UsbmonHeaderSize;
+    } else if (linkType == LinkTypeUSBLinuxMMapped) {
+        usbmonHeaderSize = UsbmonMMappedHeaderSize;
+    } else {
+        std::fclose(file);
+        return false;
+    }
+
+    uint8_t recordHeader[16];
+    std::vector<uint8_t> record;
+    while (std::fread(recordHeader, sizeof(recordHeader), 1, file) == 1) {
+        auto seconds = reader.field<uint32_t>(recordHeader, 0);
+        auto fraction = reader.field<uint32_t>(recordHeader, 4);
+        auto capturedLength = reader.field<uint32_t>(recordHeader, 8);
+
+        record.resize(capturedLength);
+        if (capturedLength > 0 && std::fread(record.data(), capturedLength, 1, file) != 1) {
+            break;
+        }
+        if (capturedLength < usbmonHeaderSize) {
+            continue;
+        }
+
+        UsbmonEvent event {};
+        event.urb = reader.field<uint64_t>(record.data(), 0);
+        event.type = static_cast<char>(record[8]);
+        event.transferType = record[9];
+        event.endpoint = record[10];
+        event.device = record[11];
+        event.bus = reader.field<uint16_t>(record.data(), 12);
+        event.status = static_cast<int32_t>(reader.field<uint32_t>(record.data(), 28));
+        event.timestamp = static_cast<int64_t>(seconds) * 1000000 + (nanos ? fraction / 1000 : fraction);
+
+        // Data is only present when flag_data is 0
+        auto dataLength = std::min<size_t>(reader.field<uint32_t>(record.data(), 36), capturedLength - usbmonHeaderSize);
+        if (record[15] == 0) {
+            event.data.assign(record.begin() + usbmonHeaderSize, record.begin() + usbmonHeaderSize + dataLength);
+        }
+
+        events.push_back(std::move(event));
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+std::optional<std::pair<uint16_t, uint8_t>> findPedal(const std::vector<UsbmonEvent> &events) {
+    // Best case, the enumeration was captured and the device descriptor identifies the pedal
+    for (auto &event: events) {
+        if (event.type == 'C' && event.transferType == UsbmonTransferControl && event.endpoint == 0x80 &&
+            event.data.size() >= 12 && event.data[1] == 0x01) {
+            uint16_t vendor = event.data[8] | (event.data[9] << 8);
+            uint16_t product = event.data[10] | (event.data[11] << 8);
+            if (vendor == CaptureVendorId && product == CaptureProductId) {
+                return std::make_pair(event.bus, event.device);
+            }
+        }
+    }
+
+    // Otherwise, anything sending config requests
+    for (auto &event: events) {
+        if (event.type == 'S' && event.transferType == UsbmonTransferInterrupt && event.endpoint == CaptureEndpoint &&
+            event.data.size() == 8 && event.data[0] == 0x01 && (event.data[1] & 0xf8) == 0x80) {
+            return std::make_pair(event.bus, event.device);
+        }
+    }
+
+    return {};
+}
+
+std::chrono::microseconds median(std::vector<int64_t> &samples) {
+    if (samples.empty()) {
+        return std::chrono::microseconds(0);
+    }
+
+    std::nth_element(samples.begin(), samples.begin() + static_cast<long>(samples.size() / 2), samples.end());
+    return std::chrono::microseconds(samples[samples.size() / 2]);
+}
+
+std::optional<SimulatorProfile> loadUsbmonCapture(const std::string &path) {
+    std::vector<UsbmonEvent> events;
+    if (!readUsbmonEvents(path, events)) {
+        return {};
+    }
+
+    auto pedal = findPedal(events);
+    if (!pedal) {
+        return {};
+    }
+
+    SimulatorProfile profile;
+    std::map<uint64_t, const UsbmonEvent *> submitted;
+    std::vector<int64_t> outSamples;
+    std::map<uint8_t, std::vector<std::vector<int64_t>>> responseSamples;
+
+    uint8_t opcode = 0;
+    uint8_t slot = 0;
+    size_t page = 0;
+    int64_t lastEvent = 0;
+    std::vector<uint8_t> response;
+    int payloadRemaining = 0;
+
+    // Stores the complete response to the previous request
+    auto finishResponse = [&]() {
+        if (response.empty()) {
+            return;
+        }
+
+        if (opcode == 0x83 && profile.versionResponse.empty()) {
+            profile.versionResponse = response;
+        } else if (opcode == 0x82 && slot > 0 && profile.slots.count(slot - 1) == 0) {
+            std::array<uint8_t, 40> contents {};
+            std::copy_n(response.begin(), std::min(response.size(), contents.size()), contents.begin());
+            profile.slots[slot - 1] = contents;
+        } else if (opcode == 0x86 && !profile.triggerModes) {
+            std::array<uint8_t, 16> contents {};
+            std::copy_n(response.begin(), std::min(response.size(), contents.size()), contents.begin());
+            profile.triggerModes = contents;
+        }
+
+        response.clear();
+    };
+
+    for (auto &event: events) {
+        if (event.bus != pedal->first || event.device != pedal->second) {
+            continue;
+        }
+        if (event.transferType != UsbmonTransferInterrupt || (event.endpoint & 0x7f) != CaptureEndpoint) {
+            continue;
+        }
+
+        if (event.type == 'S') {
+            submitted[event.urb] = &event;
+            continue;
+        }
+
+        auto it = submitted.find(event.urb);
+        if (it == submitted.end() || event.type != 'C') {
+            continue;
+        }
+        auto &submission = *it->second;
+        submitted.erase(it);
+
+        if (event.status != 0) {
+            // Cancelled or failed transfers carry no timing information about the device
+            continue;
+        }
+
+        if ((event.endpoint & 0x80) == 0) {
+            outSamples.push_back(event.timestamp - submission.timestamp);
+
+            auto &data = submission.data;
+            if (payloadRemaining > 0) {
+                payloadRemaining -= static_cast<int>(data.size());
+            } else if (data.size() == 8 && data[0] == 0x01) {
+                finishResponse();
+                opcode = data[1];
+                slot = data[3];
+                page = 0;
+                if (opcode == 0x81 || opcode == 0x85) {
+                    payloadRemaining = (data[2] + 7) & ~7;
+                }
+            }
+            lastEvent = event.timestamp;
+        } else if (!event.data.empty()) {
+            // The time since the request or previous page is how long the firmware took to produce this page
+            auto &samples = responseSamples[opcode];
+            if (samples.size() <= page) {
+                samples.resize(page + 1);
+            }
+            samples[page].push_back(event.timestamp - std::max(lastEvent, submission.timestamp));
+
+            response.insert(response.end(), event.data.begin(), event.data.end());
+            lastEvent = event.timestamp;
+            ++page;
+        }
+    }
+    finishResponse();
+
+    if (profile.versionResponse.empty()) {
+        // Without the version handshake there is no way to tell which model this is
+        return {};
+    }
+
+    std::string decoded(profile.versionResponse.begin(), profile.versionResponse.end());
+    decoded.erase(decoded.find_last_not_of('\0') + 1);
+    profile.model = decoded.substr(0, decoded.find_last_of('_'));
+
+    profile.outLatency = median(outSamples);
+    for (auto &[requestOpcode, pages]: responseSamples) {
+        auto &latencies = profile.responseLatency[requestOpcode];
+        for (auto &samples: pages) {
+            latencies.push_back(median(samples));
+        }
+    }
+    profile.defaultLatency = profile.outLatency;
+    if (profile.outLatency.count() > 0) {
+        // Captures do not usually include the config descriptor. An OUT transfer completes at the next poll, so its
+        // latency is the closest thing to the polling interval.
+        profile.endpointTiming = EndpointTiming { profile.outLatency, profile.outLatency };
+    }
+
+    return profile;
+}
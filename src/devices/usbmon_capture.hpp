@@ -0,0 +1,14 @@
+#pragma once
+
+#include "ikkegol_simulator.hpp"
+#include <optional>
+#include <string>
+
+/**
+ * Builds a simulator profile from a Linux usbmon capture (classic pcap format, as written by tcpdump -i usbmonN).
+ *
+ * The pedal is identified by its device descriptor (VID 0x1a86, PID 0xe026) if enumeration was captured, otherwise
+ * by the first device with config requests on endpoint 0x02. The responses it gave become the initial state of the
+ * model, and the time it took to produce each response page becomes the model's response latency.
+ */
+std::optional<SimulatorProfile> loadUsbmonCapture(const std::string &path);
@@ -1,11 +1,17 @@
 #include "commands.hpp"
+#include "utils/errors.hpp"
 #include <iostream>
+#include <sstream>
 #include <libusb.h>
 #include <string>
 #include <vector>
 
 int parseOptions(const std::string_view &name, const std::vector<std::string_view> &);
 
+bool verbose = false;
+bool reattachDriver = true;
+bool verifyWrites = false;
+
 int main(int argc, char **argv) {
     std::vector<std::string_view> commandLine(argc - 1);
     for (auto index = 1; index < argc; ++index) {
@@ -38,11 +44,15 @@ void printHelp(const std::string_view &name) {
         << "OPTIONS" << std::endl
         << "  -h, --help\t\tShows this help" << std::endl
         << "  -v, --version\t\tShows the version" << std::endl
+        << "  -V, --verbose\t\tReports failed transfers, retries and interface claims" << std::endl
+        << "  --no-reattach\t\tLeaves the kernel driver detached from the config interface" << std::endl
+        << "  --verify\t\tReads back what set writes and rewrites anything the device did not keep" << std::endl
         << std::endl
         << "COMMAND" << std::endl
         << "  list\t\tLists all supported pedal devices" << std::endl
         << "  show\t\tShows the current configuration of a device" << std::endl
         << "  set\t\tChanges the configuration of a device" << std::endl
+        << "  batch\t\tRuns show and set commands from a file, keeping devices open between them" << std::endl
         << std::endl;
 }
 
@@ -76,6 +86,12 @@ int parseOptions(const std::string_view &name, const std::vector<std::string_vie
         } else if (arg == "-v" || arg == "--version") {
             printVersion();
             return 0;
+        } else if (arg == "-V" || arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "--no-reattach") {
+            reattachDriver = false;
+        } else if (arg == "--verify") {
+            verifyWrites = true;
         } else {
             std::cerr << "Unknown option " << arg << std::endl;
             printHelp(name);
@@ -99,9 +115,76 @@ int parseOptions(const std::string_view &name, const std::vector<std::string_vie
         return showCommand(name, commandArgs);
     } else if (commandName == "set") {
         return setCommand(name, commandArgs);
+    } else if (commandName == "batch") {
+        return batchCommand(name, commandArgs);
     } else {
         std::cerr << "Unknown command " << commandName << std::endl;
         printHelp(name);
         return 1;
     }
-}
\ No newline at end of file
+}
+
+void reportRetries(IkkegolPedal &device) {
+    if (!verbose) {
+        return;
+    }
+
+    device.setRetryReporter([id = device.getId()](const RetryDecision &decision) {
+        // Devices may be probed concurrently, so each report is written in one go
+        std::ostringstream report;
+        report
+            << "Device " << id << ": " << decision.step << " failed on attempt " << decision.attempt << " ("
+            << describeLibUSBError(decision.result) << ", timeout " << decision.timeout.count() << " ms). ";
+        if (decision.backoff) {
+            report << "Retrying in " << decision.backoff->count() << " ms";
+        } else {
+            report << "Giving up";
+        }
+        report << std::endl;
+
+        std::cerr << report.str();
+    });
+}
+
+void applyWriteOptions(IkkegolPedal &device) {
+    device.setVerifyWrites(verifyWrites);
+}
+
+IkkegolSession beginCommandSession(IkkegolPedal &device) {
+    return IkkegolSession(device, reattachDriver);
+}
+
+std::unique_ptr<IkkegolSession> beginHeldSession(IkkegolPedal &device) {
+    return std::make_unique<IkkegolSession>(device, reattachDriver);
+}
+
+void reportInterfaceClaims(IkkegolPedal &device) {
+    if (!verbose) {
+        return;
+    }
+
+    auto &stats = device.getInterfaceClaimStats();
+    std::cerr
+        << "Device " << device.getId() << ": interface claimed " << stats.claims << " time(s), "
+        << stats.elapsed.count() / 1000.0 << " ms spent claiming and releasing" << std::endl;
+}
+
+void reportSaveStats(IkkegolPedal &device) {
+    if (!verbose) {
+        return;
+    }
+
+    auto &stats = device.getLastSaveStats();
+    std::cerr
+        << "Device " << device.getId() << ": wrote " << stats.pedalsWritten << " pedal(s)"
+        << (stats.triggerModesWritten ? " and the trigger modes" : "") << " in " << stats.transfers
+        << " transfers. Skipped " << stats.pedalsSkipped << " unchanged pedal(s), saving " << stats.transfersSaved
+        << " transfers" << std::endl;
+
+    if (verifyWrites) {
+        std::cerr
+            << "Device " << device.getId() << ": verified " << stats.pedalsVerified << " pedal(s) in "
+            << stats.verifyTransfers << " transfers, rewrote " << stats.pedalsRewritten << " pedal(s)"
+            << (stats.triggerModesRewritten ? " and the trigger modes" : "") << std::endl;
+    }
+}
@@ -1,3 +1,4 @@
+#include <cctype>
 #include <stdexcept>
 #include "command_line.hpp"
 
@@ -8,3 +9,45 @@ std::optional<int> parseInt(const std::string &input, int radix) {
         return {};
     }
 }
+
+std::optional<std::vector<std::string>> splitArguments(const std::string_view &line) {
+    std::vector<std::string> arguments;
+    std::string current;
+    // Quoted empty strings are still arguments
+    bool inArgument = false;
+    char quote = 0;
+
+    for (size_t index = 0; index < line.size(); ++index) {
+        auto character = line[index];
+
+        if (quote != 0 && character == quote) {
+            quote = 0;
+        } else if (character == '\\' && quote != '\'' && index + 1 < line.size()) {
+            current += line[++index];
+            inArgument = true;
+        } else if (quote != 0) {
+            current += character;
+        } else if (character == '\'' || character == '"') {
+            quote = character;
+            inArgument = true;
+        } else if (std::isspace(static_cast<unsigned char>(character))) {
+            if (inArgument) {
+                arguments.push_back(std::move(current));
+                current.clear();
+                inArgument = false;
+            }
+        } else {
+            current += character;
+            inArgument = true;
+        }
+    }
+
+    if (quote != 0) {
+        return {};
+    }
+    if (inArgument) {
+        arguments.push_back(std::move(current));
+    }
+
+    return arguments;
+}
@@ -2,9 +2,19 @@
 
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 std::optional<int> parseInt(const std::string &, int radix = 10);
 
 inline std::optional<int> parseInt(const std::string_view &input, int radix = 10) {
     return parseInt(std::string(input), radix);
-}
\ No newline at end of file
+}
+
+/**
+ * Splits a line into arguments the way a shell would for simple cases. Arguments are separated by whitespace, and
+ * can be quoted with ' or " to include whitespace. A backslash outside of single quotes takes the next character
+ * literally.
+ * @returns nothing if a quote is not closed
+ */
+std::optional<std::vector<std::string>> splitArguments(const std::string_view &line);
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include "name_index.hpp"
+
+template<typename Enum>
+struct EnumEntry {
+    Enum value;
+    // The code sent to the device
+    uint8_t code;
+    // The name accepted on the command line
+    std::string_view name;
+    // The name shown when printing a configuration
+    std::string_view displayName;
+};
+
+/**
+ * Translates an enum to and from its device code and names in constant time. Entries must be listed in enum order,
+ * which isValid() checks so it can be used in a static_assert beside the table.
+ */
+template<typename Enum, size_t Count>
+class EnumTable {
+public:
+    static_assert(Count > 0 && Count < 255, "Table indices are stored in a byte");
+
+    constexpr explicit EnumTable(const std::array<EnumEntry<Enum>, Count> &entries) : entries(entries) {
+        for (size_t index = 0; index < Count; ++index) {
+            auto &entry = entries[index];
+            codeIndex[entry.code] = static_cast<uint8_t>(index + 1);
+
+            // Open addressing. There are at least twice as many slots as names so there is always a free one
+            auto slot = hashName(entry.name) & (NameSlots - 1);
+            while (nameIndex[slot] != 0) {
+                slot = (slot + 1) & (NameSlots - 1);
+            }
+            nameIndex[slot] = static_cast<uint8_t>(index + 1);
+        }
+    }
+
+    constexpr const std::array<EnumEntry<Enum>, Count> &all() const { return entries; }
+
+    constexpr uint8_t toCode(Enum value) const { return get(value).code; }
+    constexpr std::string_view toName(Enum value) const { return get(value).name; }
+    constexpr std::string_view toDisplayName(Enum value) const { return get(value).displayName; }
+
+    /**
+     * Returns nothing for codes not in the table.
+     */
+    constexpr std::optional<Enum> fromCode(uint8_t code) const {
+        auto index = codeIndex[code];
+        if (index == 0) {
+            return {};
+        }
+        return entries[index - 1].value;
+    }
+
+    constexpr std::optional<Enum> fromName(std::string_view name) const {
+        auto slot = hashName(name) & (NameSlots - 1);
+        while (nameIndex[slot] != 0) {
+            auto &entry = entries[nameIndex[slot] - 1];
+            if (entry.name == name) {
+                return entry.value;
+            }
+            slot = (slot + 1) & (NameSlots - 1);
+        }
+        return {};
+    }
+
+    /**
+     * Checks the entries are in enum order, and that every code and name is unique and maps back to its entry.
+     */
+    constexpr bool isValid() const {
+        for (size_t index = 0; index < Count; ++index) {
+            auto &entry = entries[index];
+            if (static_cast<size_t>(entry.value) != index) {
+                return false;
+            }
+            if (entry.name.empty() || entry.displayName.empty()) {
+                return false;
+            }
+
+            auto fromCodeValue = fromCode(entry.code);
+            if (!fromCodeValue || *fromCodeValue != entry.value) {
+                return false;
+            }
+            auto fromNameValue = fromName(entry.name);
+            if (!fromNameValue || *fromNameValue != entry.value) {
+                return false;
+            }
+        }
+        return true;
+    }
+private:
+    static constexpr size_t slotsFor(size_t count) {
+        size_t slots = 1;
+        while (slots < count * 2) {
+            slots *= 2;
+        }
+        return slots;
+    }
+
+    static constexpr size_t NameSlots = slotsFor(Count);
+
+    std::array<EnumEntry<Enum>, Count> entries;
+    // Table index + 1 by device code, 0 for unknown codes
+    std::array<uint8_t, 256> codeIndex {};
+    // Table index + 1 by name hash, 0 for empty slots
+    std::array<uint8_t, NameSlots> nameIndex {};
+
+    constexpr const EnumEntry<Enum> &get(Enum value) const { return entries[static_cast<size_t>(value)]; }
+};
+
+template<typename Enum, size_t Count>
+constexpr EnumTable<Enum, Count> makeEnumTable(const EnumEntry<Enum> (&entries)[Count]) {
+    std::array<EnumEntry<Enum>, Count> copy {};
+    for (size_t index = 0; index < Count; ++index) {
+        copy[index] = entries[index];
+    }
+    return EnumTable<Enum, Count>(copy);
+}
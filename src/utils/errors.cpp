@@ -19,6 +19,8 @@ const std::string_view &describeLibUSBError(int code) {
             return Errors::Interrupted;
         case LIBUSB_ERROR_NO_MEM:
             return Errors::NoMem;
+        case LIBUSB_ERROR_PIPE:
+            return Errors::Stall;
         default:
             return Errors::Unknown;
     }
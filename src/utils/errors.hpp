@@ -14,6 +14,8 @@ define_error(Timeout, "Timeout while communicating with device");
 define_error(Interrupted, "Communication was interrupted");
 define_error(NoMem, "Out of memory");
 define_error(IO, "An IO error occurred while communicating with device");
+define_error(Stall, "The device rejected a transfer");
+define_error(VerifyFailed, "The device did not keep the configuration written to it");
 define_error(Unknown, "An unknown error occurred");
 }
 
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+template<typename Signature>
+class FunctionRef;
+
+/**
+ * Refers to a callable without owning or copying it, so passing one around never allocates. The callable must
+ * outlive every call made through the reference. Only named callables can be referred to, which keeps a temporary
+ * lambda from being stored past the end of the statement that made it.
+ */
+template<typename Result, typename... Args>
+class FunctionRef<Result(Args...)> {
+public:
+    FunctionRef() = default;
+
+    template<
+        typename Callable,
+        typename = std::enable_if_t<!std::is_same_v<std::remove_cv_t<Callable>, FunctionRef>>
+    >
+    FunctionRef(Callable &callable)
+        : callable(const_cast<void *>(static_cast<const void *>(&callable))), invoke(&invokeCallable<Callable>) {
+    }
+
+    template<typename Callable>
+    FunctionRef(Callable &&callable, std::enable_if_t<!std::is_lvalue_reference_v<Callable>> * = nullptr) = delete;
+
+    explicit operator bool() const { return invoke != nullptr; }
+
+    Result operator()(Args... args) const {
+        return invoke(callable, std::forward<Args>(args)...);
+    }
+
+private:
+    void *callable {};
+    Result (*invoke)(void *, Args...) {};
+
+    template<typename Callable>
+    static Result invokeCallable(void *callable, Args... args) {
+        return (*static_cast<Callable *>(callable))(std::forward<Args>(args)...);
+    }
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * FNV-1a, usable at compile time.
+ */
+constexpr uint32_t hashName(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (auto c: name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * A compile time hash index over a table of names, where a name's position in the table is its value. Null entries
+ * are skipped, and where a name appears more than once the first position wins.
+ *
+ * Slots must be a power of two, and should be at least twice the number of names to keep probes short. Use
+ * longestProbe() in a static_assert to check that it is.
+ */
+template<size_t Slots>
+class NameIndex {
+public:
+    static_assert(Slots > 0 && (Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+    constexpr NameIndex(const char *const *names, size_t count) : names(names) {
+        for (size_t index = 0; index < count; ++index) {
+            if (names[index] == nullptr || find(names[index]) >= 0) {
+                continue;
+            }
+
+            auto slot = hashName(names[index]) & (Slots - 1);
+            size_t probes = 1;
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & (Slots - 1);
+                ++probes;
+            }
+            slots[slot] = static_cast<uint16_t>(index + 1);
+
+            if (probes > maxProbes) {
+                maxProbes = probes;
+            }
+        }
+    }
+
+    /**
+     * The position of the name in the table, or -1 if it is not there.
+     */
+    constexpr int find(std::string_view name) const {
+        auto slot = hashName(name) & (Slots - 1);
+        while (slots[slot] != 0) {
+            auto index = slots[slot] - 1;
+            if (name == names[index]) {
+                return index;
+            }
+            slot = (slot + 1) & (Slots - 1);
+        }
+
+        return -1;
+    }
+
+    /**
+     * The most slots looked at to find any name in the table.
+     */
+    constexpr size_t longestProbe() const { return maxProbes; }
+private:
+    const char *const *names;
+    // Table position + 1 by hash, 0 for empty slots
+    std::array<uint16_t, Slots> slots {};
+    size_t maxProbes { 0 };
+};
@@ -0,0 +1,94 @@
+#include "retry_policy.hpp"
+#include <libusb.h>
+#include <algorithm>
+#include <cmath>
+
+// Responses needed before the estimate is trusted over the caller's default
+const uint32_t MinSamples = 8;
+// Weight of each new response in the estimate
+const double SmoothingFactor = 0.125;
+// Standard deviations above the mean before a transfer is considered lost
+const double DeviationFactor = 4;
+// Allows for scheduling delays on the host, which have nothing to do with the device
+const std::chrono::milliseconds MinTimeout(15);
+const uint32_t MinTimeoutPolls = 2;
+const std::chrono::milliseconds MaxTimeout(1000);
+
+const uint32_t MaxAttempts = 4;
+const std::chrono::milliseconds BaseBackoff(5);
+const std::chrono::milliseconds MaxBackoff(40);
+
+void RetryPolicy::recordResponse(std::chrono::microseconds latency) {
+    auto sample = static_cast<double>(latency.count());
+
+    if (samples == 0) {
+        mean = sample;
+        variance = 0;
+    } else {
+        auto difference = sample - mean;
+        auto increment = SmoothingFactor * difference;
+        mean += increment;
+        variance = (1 - SmoothingFactor) * (variance + difference * increment);
+    }
+
+    ++samples;
+}
+
+std::chrono::milliseconds RetryPolicy::getTimeout(std::chrono::milliseconds defaultTimeout, uint32_t attempt) const {
+    auto timeout = defaultTimeout;
+    if (samples >= MinSamples) {
+        auto estimate = std::chrono::milliseconds(
+            static_cast<int64_t>(std::ceil((mean + DeviationFactor * std::sqrt(variance)) / 1000))
+        );
+        auto floor = std::max(
+            MinTimeout, std::chrono::ceil<std::chrono::milliseconds>(pollInterval * MinTimeoutPolls)
+        );
+        timeout = std::clamp(estimate, std::min(floor, MaxTimeout), MaxTimeout);
+    }
+
+    // A timeout may have been too tight, so each retry waits twice as long as the last
+    auto ceiling = std::max(timeout, defaultTimeout);
+    for (uint32_t retry = 1; retry < attempt && timeout < ceiling; ++retry) {
+        timeout *= 2;
+    }
+
+    return std::min(timeout, ceiling);
+}
+
+std::optional<std::chrono::milliseconds> RetryPolicy::onFailure(
+    std::string_view step, uint32_t attempt, int result, bool idempotent, std::chrono::milliseconds timeout
+) {
+    bool transient;
+    switch (result) {
+        case LIBUSB_ERROR_IO:
+        case LIBUSB_ERROR_TIMEOUT:
+        case LIBUSB_ERROR_PIPE:
+        case LIBUSB_ERROR_OVERFLOW:
+        case LIBUSB_ERROR_INTERRUPTED:
+        case LIBUSB_ERROR_OTHER:
+            transient = true;
+            break;
+        default:
+            // Eg. the device was unplugged or we do not have access to it
+            transient = false;
+            break;
+    }
+
+    RetryDecision decision { step, attempt, result, timeout, {}};
+    if (idempotent && transient && attempt < MaxAttempts) {
+        auto base = std::max(BaseBackoff, std::chrono::ceil<std::chrono::milliseconds>(pollInterval));
+        auto ceiling = std::max(MaxBackoff, base);
+        auto backoff = base;
+        for (uint32_t retry = 1; retry < attempt && backoff < ceiling; ++retry) {
+            backoff *= 2;
+        }
+        decision.backoff = std::min(backoff, ceiling);
+        ++retries;
+    }
+
+    if (reporter) {
+        reporter(decision);
+    }
+
+    return decision.backoff;
+}
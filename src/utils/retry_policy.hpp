@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string_view>
+
+/**
+ * What a RetryPolicy decided after a step failed.
+ */
+struct RetryDecision {
+    std::string_view step;
+    uint32_t attempt;
+    // The LIBUSB_ERROR_* code the attempt failed with
+    int result;
+    // The idle timeout the attempt was given
+    std::chrono::milliseconds timeout;
+    // Set when the step will be attempted again after this delay, otherwise the step has failed
+    std::optional<std::chrono::milliseconds> backoff;
+};
+
+/**
+ * Sizes transfer timeouts from the response times seen on a single device, and decides which failures are worth
+ * retrying.
+ * The timeout is the mean time between completions plus a number of standard deviations, so a healthy device gives
+ * up on a lost transfer long before the worst case timeout. Until enough responses have been seen, the caller's
+ * default is used instead.
+ */
+class RetryPolicy {
+public:
+    typedef std::function<void(const RetryDecision &)> Reporter;
+
+    /**
+     * Adds the time between two completions (or the start of a wait and its first completion) to the estimate.
+     */
+    void recordResponse(std::chrono::microseconds latency);
+
+    /**
+     * The idle timeout for an attempt at a step. Later attempts get longer timeouts, up to at least the default.
+     */
+    std::chrono::milliseconds getTimeout(std::chrono::milliseconds defaultTimeout, uint32_t attempt = 1) const;
+
+    /**
+     * Decides what to do after an attempt at a step failed. Only idempotent steps are retried, and only for
+     * errors that a second attempt could fix.
+     * @returns the delay before the next attempt, or nothing if the step has failed
+     */
+    std::optional<std::chrono::milliseconds> onFailure(
+        std::string_view step, uint32_t attempt, int result, bool idempotent, std::chrono::milliseconds timeout
+    );
+
+    /**
+     * Receives every decision made by onFailure()
+     */
+    void setReporter(Reporter reporter) { this->reporter = std::move(reporter); }
+
+    /**
+     * The rate the host polls the device at. Nothing can complete faster than this, so timeouts are never shorter
+     * than a couple of polls and retries wait at least one.
+     */
+    void setPollInterval(std::chrono::microseconds interval) { pollInterval = interval; }
+
+    uint32_t getRetryCount() const { return retries; }
+
+private:
+    // Exponentially weighted, so the estimate follows a device that speeds up or slows down
+    double mean { 0 };
+    double variance { 0 };
+    uint32_t samples { 0 };
+    uint32_t retries { 0 };
+    std::chrono::microseconds pollInterval { 0 };
+    Reporter reporter;
+};
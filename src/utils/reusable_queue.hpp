@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * A first in, first out queue over a vector. Taking from the front only moves a read position, and the storage is
+ * reused once the queue has been emptied, so a queue which is regularly drained stops allocating once it has been as
+ * long as it ever gets.
+ */
+template<typename T>
+class ReusableQueue {
+public:
+    bool empty() const { return start == items.size(); }
+
+    T &front() { return items[start]; }
+
+    void push_back(T item) { items.push_back(std::move(item)); }
+
+    void pop_front() {
+        if (++start == items.size()) {
+            clear();
+        }
+    }
+
+    void clear() {
+        items.clear();
+        start = 0;
+    }
+
+private:
+    std::vector<T> items;
+    size_t start { 0 };
+};
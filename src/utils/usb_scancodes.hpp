@@ -254,7 +254,7 @@ constexpr auto generatePrintableReverseLut() {
 constexpr auto PrintableCharsToScancodes = generatePrintableReverseLut();
 
 constexpr const char *scanCodeToKey(int scanCode) {
-    if (scanCode < 0 || scanCode > sizeof(ScanCodeNames)) {
+    if (scanCode < 0 || scanCode >= sizeof(ScanCodeNames) / sizeof(const char *)) {
         return nullptr;
     }
 
@@ -262,15 +262,14 @@ constexpr const char *scanCodeToKey(int scanCode) {
 }
 
 constexpr char scanCodeToPrintable(int scanCode, bool shift) {
-    if (scanCode < 0 || scanCode > sizeof(PrintableScanCodes) || !PrintableScanCodes[scanCode]) {
+    constexpr auto size = sizeof(PrintableScanCodes) / sizeof(const char *);
+    if (scanCode < 0 || scanCode >= size || !PrintableScanCodes[scanCode]) {
         return '\0';
     }
 
     return PrintableScanCodes[scanCode][shift ? 1 : 0];
 }
 
-int scanCodeFromKey(const std::string_view &name);
-
 constexpr int scanCodeFromPrintable(char ch) {
     if (ch < 0) {
         return -1;
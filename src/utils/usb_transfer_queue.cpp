@@ -0,0 +1,412 @@
+#include "usb_transfer_queue.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+// libusb_dev_mem_alloc arrived in libusb 1.0.21
+#if defined(LIBUSB_API_VERSION) && LIBUSB_API_VERSION >= 0x01000105
+#define USE_DEVICE_MEMORY 1
+#else
+#define USE_DEVICE_MEMORY 0
+#endif
+
+const size_t TransfersPerBlock = 32;
+const size_t TransferBufferAlignment = 64;
+
+int describeTransferStatus(libusb_transfer_status status) {
+    switch (status) {
+        case LIBUSB_TRANSFER_COMPLETED:
+            return 0;
+        case LIBUSB_TRANSFER_TIMED_OUT:
+            return LIBUSB_ERROR_TIMEOUT;
+        case LIBUSB_TRANSFER_CANCELLED:
+            return LIBUSB_ERROR_INTERRUPTED;
+        case LIBUSB_TRANSFER_STALL:
+            return LIBUSB_ERROR_PIPE;
+        case LIBUSB_TRANSFER_NO_DEVICE:
+            return LIBUSB_ERROR_NO_DEVICE;
+        case LIBUSB_TRANSFER_OVERFLOW:
+            return LIBUSB_ERROR_OVERFLOW;
+        default:
+            return LIBUSB_ERROR_IO;
+    }
+}
+
+USBTransferQueue::USBTransferQueue(libusb_device_handle *handle, uint8_t endpoint)
+    : handle(handle), endpoint(endpoint & LIBUSB_ENDPOINT_ADDRESS_MASK) {
+    // Enough for any exchange the pedals have, so the pool normally never needs to grow
+    grow(TransfersPerBlock);
+}
+
+USBTransferQueue::~USBTransferQueue() {
+    if (outstanding > 0) {
+        cancelAll();
+        wait(std::chrono::milliseconds(100));
+    }
+
+    // Give transfers left over from earlier exchanges one last chance to finish
+    for (auto &transfer: detached) {
+        libusb_cancel_transfer(transfer->transfer);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    while (!detached.empty() && std::chrono::steady_clock::now() < deadline) {
+        timeval tv { 0, 10000 };
+        libusb_handle_events_timeout_completed(nullptr, &tv, &finishedFlag);
+        handleFinished();
+    }
+
+    // Anything still active at this point will never be freed safely, nor will the memory it uses
+    if (!detached.empty()) {
+        for (auto &transfer: detached) {
+            transfer.release();
+        }
+        return;
+    }
+
+    for (auto &transfer: spare) {
+        libusb_free_transfer(transfer->transfer);
+    }
+    for (auto &block: bufferBlocks) {
+#if USE_DEVICE_MEMORY
+        if (block.deviceMemory) {
+            libusb_dev_mem_free(handle, block.memory, block.length);
+            continue;
+        }
+#endif
+        std::free(block.memory);
+    }
+}
+
+bool USBTransferQueue::usesDeviceMemory() const {
+    return !bufferBlocks.empty() && bufferBlocks.front().deviceMemory;
+}
+
+bool USBTransferQueue::grow(size_t transfers) {
+    BufferBlock block { nullptr, transfers * MaxTransferLength, false };
+#if USE_DEVICE_MEMORY
+    block.memory = libusb_dev_mem_alloc(handle, block.length);
+    block.deviceMemory = (block.memory != nullptr);
+#endif
+    if (block.memory == nullptr) {
+        block.memory = static_cast<uint8_t *>(std::aligned_alloc(TransferBufferAlignment, block.length));
+    }
+    if (block.memory == nullptr) {
+        return false;
+    }
+    bufferBlocks.push_back(block);
+
+    // Nothing that holds transfers may need to allocate while an exchange is running
+    auto newSize = poolSize + transfers;
+    pending.reserve(newSize);
+    detached.reserve(newSize);
+    spare.reserve(newSize);
+    finishing.reserve(newSize);
+    {
+        std::lock_guard lock(finishedLock);
+        finished.reserve(newSize);
+    }
+    for (auto &queue: held) {
+        queue.reserve(newSize);
+    }
+
+    for (size_t index = 0; index < transfers; ++index) {
+        auto transfer = std::make_unique<Pending>();
+        transfer->transfer = libusb_alloc_transfer(0);
+        if (transfer->transfer == nullptr) {
+            break;
+        }
+        transfer->queue = this;
+        transfer->transferBuffer = &block.memory[index * MaxTransferLength];
+
+        spare.push_back(std::move(transfer));
+        ++poolSize;
+    }
+
+    return !spare.empty();
+}
+
+std::unique_ptr<USBTransferQueue::Pending> USBTransferQueue::acquire() {
+    if (spare.empty() && !grow(TransfersPerBlock)) {
+        return nullptr;
+    }
+
+    auto transfer = std::move(spare.back());
+    spare.pop_back();
+
+    transfer->actualLength = 0;
+    transfer->result = 0;
+    transfer->active = false;
+    transfer->detached = false;
+    return transfer;
+}
+
+void USBTransferQueue::recycle(std::unique_ptr<Pending> transfer) {
+    transfer->callback = {};
+    transfer->buffer = nullptr;
+    spare.push_back(std::move(transfer));
+}
+
+int USBTransferQueue::submitOut(const uint8_t *data, int length, Callback callback) {
+    assert(length <= MaxTransferLength);
+
+    auto transfer = acquire();
+    if (!transfer) {
+        return LIBUSB_ERROR_NO_MEM;
+    }
+
+    std::memcpy(transfer->transferBuffer, data, length);
+    transfer->buffer = transfer->transferBuffer;
+    transfer->length = length;
+    transfer->callback = callback;
+
+    return submit(std::move(transfer), endpoint | LIBUSB_ENDPOINT_OUT);
+}
+
+int USBTransferQueue::submitIn(uint8_t *buffer, int length, Callback callback) {
+    assert(length <= MaxTransferLength);
+
+    auto transfer = acquire();
+    if (!transfer) {
+        return LIBUSB_ERROR_NO_MEM;
+    }
+
+    transfer->buffer = buffer;
+    transfer->length = length;
+    transfer->callback = callback;
+
+    return submit(std::move(transfer), endpoint | LIBUSB_ENDPOINT_IN);
+}
+
+size_t directionIndex(uint8_t endpoint) {
+    return (endpoint & LIBUSB_ENDPOINT_DIR_MASK) == LIBUSB_ENDPOINT_IN ? 1 : 0;
+}
+
+int USBTransferQueue::submit(std::unique_ptr<Pending> transfer, uint8_t endpointAddress) {
+    if (firstError < 0) {
+        // Don't continue an exchange which has already failed
+        recycle(std::move(transfer));
+        return firstError;
+    }
+
+    transfer->endpoint = endpointAddress;
+
+    // Timeouts are handled by wait() so that a slow first transfer does not count against later ones
+    libusb_fill_interrupt_transfer(
+        transfer->transfer, handle, endpointAddress, transfer->transferBuffer, transfer->length, onTransferComplete,
+        transfer.get(), 0
+    );
+
+    // Anything already held back goes first so the order on the endpoint is preserved
+    auto direction = directionIndex(endpointAddress);
+    if (inFlight[direction] >= maxInFlight || heldStart[direction] < held[direction].size()) {
+        held[direction].push_back(std::move(transfer));
+        return 0;
+    }
+
+    return start(std::move(transfer));
+}
+
+int USBTransferQueue::start(std::unique_ptr<Pending> transfer) {
+    auto result = libusb_submit_transfer(transfer->transfer);
+    if (result < 0) {
+        recycle(std::move(transfer));
+        if (firstError == 0) {
+            firstError = result;
+        }
+        return result;
+    }
+
+    transfer->active = true;
+    ++inFlight[directionIndex(transfer->endpoint)];
+    ++outstanding;
+    pending.push_back(std::move(transfer));
+    return 0;
+}
+
+void USBTransferQueue::startHeld(size_t direction) {
+    auto &queue = held[direction];
+    auto &next = heldStart[direction];
+    while (next < queue.size() && inFlight[direction] < maxInFlight && firstError == 0) {
+        auto transfer = std::move(queue[next++]);
+
+        if (start(std::move(transfer)) < 0) {
+            // Nothing after it can be sent either
+            cancelAll();
+        }
+    }
+
+    if (next == queue.size()) {
+        queue.clear();
+        next = 0;
+    }
+}
+
+int USBTransferQueue::wait(std::chrono::milliseconds idleTimeout) {
+    int lastCompletions = completions;
+    auto deadline = std::chrono::steady_clock::now() + idleTimeout;
+    bool timedOut = false;
+
+    while (true) {
+        handleFinished();
+        if (outstanding == 0) {
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (completions != lastCompletions) {
+            lastCompletions = completions;
+            deadline = now + idleTimeout;
+        }
+
+        if (now >= deadline) {
+            if (timedOut) {
+                // Cancellation should be near instant. Don't wait forever if the device has gone away
+                break;
+            }
+
+            timedOut = true;
+            cancelAll();
+            deadline = now + idleTimeout;
+            continue;
+        }
+
+        auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now);
+        timeval tv {
+            static_cast<time_t>(remaining.count() / 1000000),
+            static_cast<suseconds_t>(remaining.count() % 1000000),
+        };
+
+        // Returns as soon as one of this queue's transfers finishes, even if another thread is handling events
+        auto result = libusb_handle_events_timeout_completed(nullptr, &tv, &finishedFlag);
+        if (result < 0 && result != LIBUSB_ERROR_INTERRUPTED) {
+            cancelAll();
+            if (firstError == 0) {
+                firstError = result;
+            }
+        }
+    }
+
+    auto result = firstError;
+    if (timedOut) {
+        result = LIBUSB_ERROR_TIMEOUT;
+    }
+
+    release();
+    firstError = 0;
+    return result;
+}
+
+void USBTransferQueue::cancelAll() {
+    // Held transfers never reached libusb, so they can go straight back to the pool
+    for (size_t direction = 0; direction < 2; ++direction) {
+        auto &queue = held[direction];
+        for (auto index = heldStart[direction]; index < queue.size(); ++index) {
+            recycle(std::move(queue[index]));
+        }
+        queue.clear();
+        heldStart[direction] = 0;
+    }
+
+    for (auto &transfer: pending) {
+        if (transfer->active) {
+            libusb_cancel_transfer(transfer->transfer);
+        }
+    }
+}
+
+void USBTransferQueue::release() {
+    for (auto &transfer: pending) {
+        if (!transfer->active) {
+            recycle(std::move(transfer));
+            continue;
+        }
+
+        // The device stopped responding to cancellation. libusb may still write to the transfer's memory, so it is
+        // kept out of the pool until it ends, but it is no longer part of any exchange. Its callback refers to the
+        // attempt which has just given up on it.
+        transfer->callback = {};
+        transfer->detached = true;
+        --inFlight[directionIndex(transfer->endpoint)];
+        --outstanding;
+        detached.push_back(std::move(transfer));
+    }
+
+    pending.clear();
+}
+
+void USBTransferQueue::reclaim(Pending *transfer) {
+    auto found = std::find_if(detached.begin(), detached.end(), [transfer](const std::unique_ptr<Pending> &entry) {
+        return entry.get() == transfer;
+    });
+    if (found == detached.end()) {
+        return;
+    }
+
+    auto entry = std::move(*found);
+    detached.erase(found);
+    recycle(std::move(entry));
+}
+
+void USBTransferQueue::handleFinished() {
+    {
+        std::lock_guard lock(finishedLock);
+        finishing.swap(finished);
+        finishedFlag = 0;
+    }
+
+    for (auto *transfer: finishing) {
+        complete(transfer);
+    }
+    finishing.clear();
+}
+
+void USBTransferQueue::complete(Pending *pending) {
+    auto *transfer = pending->transfer;
+
+    pending->active = false;
+    if (pending->detached) {
+        reclaim(pending);
+        return;
+    }
+
+    pending->actualLength = std::min(transfer->actual_length, pending->length);
+    pending->result = describeTransferStatus(transfer->status);
+
+    if ((pending->endpoint & LIBUSB_ENDPOINT_DIR_MASK) == LIBUSB_ENDPOINT_IN && pending->actualLength > 0) {
+        std::memcpy(pending->buffer, pending->transferBuffer, pending->actualLength);
+    }
+
+    auto direction = directionIndex(pending->endpoint);
+    --inFlight[direction];
+    ++completions;
+
+    if (pending->result < 0) {
+        if (firstError == 0) {
+            firstError = pending->result;
+        }
+        // The rest of the exchange is meaningless without this transfer
+        cancelAll();
+    } else {
+        // Transfers held back were queued before anything the callback adds
+        startHeld(direction);
+        if (completionListener) {
+            completionListener(*pending);
+        }
+        if (pending->callback) {
+            pending->callback(*pending);
+        }
+    }
+
+    --outstanding;
+}
+
+void LIBUSB_CALL USBTransferQueue::onTransferComplete(libusb_transfer *transfer) {
+    auto *pending = static_cast<Pending *>(transfer->user_data);
+    auto *queue = pending->queue;
+
+    // This may be any thread handling events, so the queue's own thread takes it from here
+    std::lock_guard lock(queue->finishedLock);
+    queue->finished.push_back(pending);
+    queue->finishedFlag = 1;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <libusb.h>
+#include <algorithm>
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "function_ref.hpp"
+
+struct USBTransfer {
+    // The endpoint address, including the direction bit
+    uint8_t endpoint { 0 };
+    uint8_t *buffer {};
+    int length { 0 };
+    int actualLength { 0 };
+    // 0 on success, otherwise a LIBUSB_ERROR_* code
+    int result { 0 };
+};
+
+/**
+ * Issues asynchronous interrupt transfers on a single endpoint pair.
+ * Transfers are submitted as soon as they are queued so the host controller can service them back-to-back at the
+ * endpoint's polling interval instead of waiting for a full round trip between each one. The number in flight on
+ * each endpoint can be limited, in which case the rest are held back and submitted in order as earlier ones complete.
+ *
+ * Transfers and their buffers come from a pool which only ever grows, so once it is big enough for the largest
+ * exchange nothing more is allocated. Buffers are device memory from libusb_dev_mem_alloc where the kernel supports
+ * it, which usbfs can hand to the host controller without copying, otherwise aligned heap memory.
+ *
+ * Devices used from different threads share the default context, and libusb completes a transfer on whichever of them
+ * is handling its events. Completions are only handed over there. Everything they lead to, callbacks included, happens
+ * on the thread calling wait().
+ */
+class USBTransferQueue {
+public:
+    // Callbacks are referred to, not copied, and must stay valid until wait() returns
+    typedef FunctionRef<void(USBTransfer &)> Callback;
+    // Called for every transfer which completes successfully, before its own callback
+    typedef std::function<void(USBTransfer &)> CompletionListener;
+
+    // Enough for the largest full speed interrupt packet
+    static constexpr int MaxTransferLength = 64;
+
+    explicit USBTransferQueue(libusb_device_handle *, uint8_t endpoint);
+    ~USBTransferQueue();
+
+    /**
+     * Queues an OUT transfer. The data is copied so it does not need to outlive this call.
+     */
+    int submitOut(const uint8_t *data, int length, Callback callback = {});
+
+    /**
+     * Queues an IN transfer into the given buffer. The buffer must stay valid until wait() returns.
+     * Callbacks may queue further transfers, eg. to read the remaining pages of a response.
+     */
+    int submitIn(uint8_t *buffer, int length, Callback callback = {});
+
+    /**
+     * Handles events until all queued transfers have finished.
+     * If no transfer completes within idleTimeout, everything outstanding is cancelled.
+     * @returns 0 on success, otherwise the first error encountered
+     */
+    int wait(std::chrono::milliseconds idleTimeout);
+
+    void setCompletionListener(CompletionListener listener) { completionListener = std::move(listener); }
+
+    /**
+     * Limits the number of transfers in flight on each endpoint. Defaults to unlimited.
+     */
+    void setMaxInFlight(size_t transfers) { maxInFlight = std::max<size_t>(transfers, 1); }
+
+    /**
+     * The number of transfers allocated so far, and whether their buffers are device memory.
+     */
+    size_t getPoolSize() const { return poolSize; }
+    bool usesDeviceMemory() const;
+
+private:
+    struct Pending : USBTransfer {
+        USBTransferQueue *queue {};
+        libusb_transfer *transfer {};
+        // The pooled memory libusb transfers from. IN data is copied out to buffer on completion.
+        uint8_t *transferBuffer {};
+        Callback callback;
+        bool active { false };
+        // Given up on by an exchange which has finished. Nothing is done with it beyond taking it back when it ends
+        bool detached { false };
+    };
+
+    struct BufferBlock {
+        uint8_t *memory;
+        size_t length;
+        bool deviceMemory;
+    };
+
+    libusb_device_handle *handle;
+    uint8_t endpoint;
+    std::vector<std::unique_ptr<Pending>> pending;
+    // Transfers which outlived the exchange they were part of, until libusb is done with them
+    std::vector<std::unique_ptr<Pending>> detached;
+    // Transfers waiting for room on their endpoint, from heldStart on. Indexed by direction, OUT then IN
+    std::vector<std::unique_ptr<Pending>> held[2];
+    size_t heldStart[2] {};
+    size_t inFlight[2] {};
+    size_t maxInFlight { SIZE_MAX };
+    CompletionListener completionListener;
+    int outstanding { 0 };
+    int completions { 0 };
+    int firstError { 0 };
+
+    // Transfers libusb has finished with, waiting for wait() to handle them. Filled from any thread handling events.
+    std::mutex finishedLock;
+    std::vector<Pending *> finished;
+    // Swapped with finished to handle them outside the lock
+    std::vector<Pending *> finishing;
+    // Set along with finished, so libusb wakes the thread waiting on this queue
+    int finishedFlag { 0 };
+
+    // The pool
+    std::vector<std::unique_ptr<Pending>> spare;
+    std::vector<BufferBlock> bufferBlocks;
+    size_t poolSize { 0 };
+
+    std::unique_ptr<Pending> acquire();
+    void recycle(std::unique_ptr<Pending> transfer);
+    bool grow(size_t transfers);
+
+    int submit(std::unique_ptr<Pending> transfer, uint8_t endpointAddress);
+    int start(std::unique_ptr<Pending> transfer);
+    void startHeld(size_t direction);
+    void cancelAll();
+    void release();
+    void reclaim(Pending *transfer);
+    void handleFinished();
+    void complete(Pending *transfer);
+
+    static void LIBUSB_CALL onTransferComplete(libusb_transfer *);
+};
\ No newline at end of file